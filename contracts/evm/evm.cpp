@@ -423,7 +423,7 @@ public:
         const uint8_t *buffer = (const uint8_t*)rawdata.data();
         uint64_t size = rawdata.size();
         uint160_t sender = convert(_sender);
-        struct txn txn = {0, 0, 0, false, 0, 0, nullptr, 0, false, 0, 0, 0};
+        struct txn txn = {0, 0, 0, false, 0, 0, nullptr, 0, false, 0, 0, 0, nullptr, 0, 0};
         _try({
             _catches(decode_txn)(buffer, size, txn);
         }, Error e, {
@@ -438,8 +438,9 @@ public:
             _try({
                 Release release = get_release(forknumber());
                 _catches(verify_txn)(release, txn);
-                uint256_t h = _catches(hash_txn)(txn);
-                sender = _catches(ecrecover)(h, txn.v, txn.r, txn.s);
+                Error result;
+                recover_senders(release, &txn, 1, &sender, &result);
+                if (result != NONE) _trythrow(result);
             }, Error e, {
                 check(false, "invalid transaction");
             })
@@ -476,26 +477,15 @@ public:
         const uint8_t *name = (const uint8_t*)_name.c_str();
         const uint8_t *data = (const uint8_t*)_data.c_str();
         uint160_t address;
-        struct rlp rlp = {false, 0, {nullptr}};
         _try({
-            rlp.is_list = true;
-            rlp.size = 2;
-            rlp.list = _new<struct rlp>(rlp.size);
-            rlp.list[0].is_list = false;
-            rlp.list[0].size = _name.size();
-            rlp.list[0].data = _new<uint8_t>(rlp.list[0].size);
-            for (uint64_t i = 0; i < rlp.list[0].size; i++) rlp.list[0].data[i] = name[i];
-            rlp.list[1].is_list = false;
-            rlp.list[1].size = _data.size();
-            rlp.list[1].data = _new<uint8_t>(rlp.list[1].size);
-            for (uint64_t i = 0; i < rlp.list[1].size; i++) rlp.list[1].data[i] = data[i];
-            uint64_t size = _catches(dump_rlp)(rlp, nullptr, 0);
-            local<uint8_t> buffer_l(size); uint8_t *buffer = buffer_l.data;
-            _catches(dump_rlp)(rlp, buffer, size);
-            free_rlp(rlp);
-            address = (uint160_t)sha3(buffer, size);
+            uint64_t bound = _name.size() + _data.size() + 3 * (1 + 8);
+            local<uint8_t> buffer_l(bound); uint8_t *buffer = buffer_l.data;
+            struct rlp_writer w = {buffer, bound, 0};
+            _catches(rlp_bytes)(w, data, _data.size());
+            _catches(rlp_bytes)(w, name, _name.size());
+            _catches(rlp_list)(w, 0);
+            address = (uint160_t)sha3(&buffer[bound - w.size], w.size);
         }, Error e, {
-            free_rlp(rlp);
             check(false, "execution failure: " + string(errors[e]));
         })
         // the operation should create a new account table entry
@@ -809,7 +799,7 @@ private:
         uint64_t acc_id = get_account(address);
         if (acc_id > 0) {
             auto idx = _state.get_index<"state2"_n>();
-            for (auto itr = idx.find(acc_id); itr != idx.end(); ) {
+            for (auto itr = idx.find(acc_id); itr != idx.end() && itr->acc_id == acc_id; ) {
                 itr = idx.erase(itr);
             }
         }
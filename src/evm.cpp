@@ -1,10 +1,18 @@
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <cstring>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <sstream>
 #include <stdint.h>
+#include <string>
+#include <system_error>
+#include <thread>
 
 #include "evm.hpp"
 
@@ -65,16 +73,27 @@ private:
     uint64_t keyvalue_size = 0;
     uint64_t keyvalue_index[L];
     uint256_t keyvalue_list[L][2];
+    // the storage slots of each account are chained, so that loading,
+    // storing and clearing only visit the slots of the account at hand
+    uint64_t account_first[L]; // first slot of the account, L if none
+    uint64_t keyvalue_prev[L]; // previous slot of the same account, L if none
+    uint64_t keyvalue_next[L]; // next slot of the same account, L if none
     uint64_t contract_size = 0;
     uint256_t contract_index[L];
     struct contract contract_list[L];
-    struct rlp logs = {true, 0, {nullptr}};
+    std::vector<uint8_t> logs; // concatenated rlp encoded log entries
     const struct account *find(const uint160_t &account) const {
         for (uint64_t i = 0; i < account_size; i++) {
             if (account == account_index[i]) return &account_list[i];
         }
         return nullptr;
     }
+    uint64_t locate(const uint160_t &account) const {
+        for (uint64_t i = 0; i < account_size; i++) {
+            if (account == account_index[i]) return i;
+        }
+        return account_size;
+    }
     const struct contract *find(const uint256_t &codehash) const {
         for (uint64_t i = 0; i < contract_size; i++) {
             if (codehash == contract_index[i]) return &contract_list[i];
@@ -101,6 +120,7 @@ private:
             account_list[account_size].nonce = 0;
             account_list[account_size].balance = 0;
             account_list[account_size].codehash = 0;
+            account_first[account_size] = L;
             account_size++;
         }
         account_list[index].nonce = nonce;
@@ -127,6 +147,34 @@ private:
         contract_list[index].code = code;
         contract_list[index].code_size = size;
     }
+    // adds a slot to the chain of its account
+    void link(uint64_t slot) {
+        uint64_t index = keyvalue_index[slot];
+        keyvalue_prev[slot] = L;
+        keyvalue_next[slot] = account_first[index];
+        if (account_first[index] < L) keyvalue_prev[account_first[index]] = slot;
+        account_first[index] = slot;
+    }
+    void unlink(uint64_t slot) {
+        uint64_t prev = keyvalue_prev[slot], next = keyvalue_next[slot];
+        if (prev < L) keyvalue_next[prev] = next; else account_first[keyvalue_index[slot]] = next;
+        if (next < L) keyvalue_prev[next] = prev;
+    }
+    // removes a slot moving the last one into its place
+    void erase(uint64_t slot) {
+        unlink(slot);
+        keyvalue_size--;
+        if (slot < keyvalue_size) {
+            uint64_t last = keyvalue_size;
+            keyvalue_index[slot] = keyvalue_index[last];
+            keyvalue_list[slot][0] = keyvalue_list[last][0];
+            keyvalue_list[slot][1] = keyvalue_list[last][1];
+            keyvalue_prev[slot] = keyvalue_prev[last];
+            keyvalue_next[slot] = keyvalue_next[last];
+            if (keyvalue_prev[slot] < L) keyvalue_next[keyvalue_prev[slot]] = slot; else account_first[keyvalue_index[slot]] = slot;
+            if (keyvalue_next[slot] < L) keyvalue_prev[keyvalue_next[slot]] = slot;
+        }
+    }
     void load(uint64_t hash) {
         std::stringstream ss;
         ss << std::hex << std::setw(8) << std::setfill('0') << hash;
@@ -147,14 +195,20 @@ private:
             uint64_t code_size = b2w32le(&buffer[offset]); offset += 4;
             uint64_t code_offset = offset; offset += code_size;
             account_list[i].codehash = uint256_t::from(&buffer[offset]); offset += 32;
+            account_first[i] = L;
             update(account_list[i].codehash, &buffer[code_offset], code_size);
         }
-        keyvalue_size = b2w32le(&buffer[offset]); offset += 4;
-        assert(keyvalue_size <= L);
-        for (uint64_t i = 0; i < keyvalue_size; i++) {
-            keyvalue_index[i] = b2w32le(&buffer[offset]); offset += 4;
-            keyvalue_list[i][0] = uint256_t::from(&buffer[offset]); offset += 32;
-            keyvalue_list[i][1] = uint256_t::from(&buffer[offset]); offset += 32;
+        uint64_t count = b2w32le(&buffer[offset]); offset += 4;
+        assert(count <= L);
+        keyvalue_size = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            keyvalue_index[keyvalue_size] = b2w32le(&buffer[offset]); offset += 4;
+            keyvalue_list[keyvalue_size][0] = uint256_t::from(&buffer[offset]); offset += 32;
+            keyvalue_list[keyvalue_size][1] = uint256_t::from(&buffer[offset]); offset += 32;
+            // slots left behind by removed accounts are unreachable and dropped
+            if (keyvalue_index[keyvalue_size] >= account_size) continue;
+            link(keyvalue_size);
+            keyvalue_size++;
         }
     }
     uint64_t dump() const {
@@ -220,7 +274,7 @@ public:
             load(hash);
         }
     }
-    ~_State() { reset(); free_rlp(logs); }
+    ~_State() { reset(); }
     void save() {
         uint64_t hash = dump();
         std::stringstream ss;
@@ -275,8 +329,9 @@ public:
     };
 
     inline uint256_t load(const uint160_t &address, const uint256_t &key) const {
-        for (uint64_t i = 0; i < keyvalue_size; i++) {
-            if (keyvalue_list[i][0] == key && address == account_index[keyvalue_index[i]]) {
+        uint64_t index = locate(address);
+        for (uint64_t i = index < account_size ? account_first[index] : L; i < L; i = keyvalue_next[i]) {
+            if (keyvalue_list[i][0] == key) {
                 if (std::getenv("EVM_DEBUG")) std::cout << "debug: load " << address << " " << key << " " << keyvalue_list[i][1] << std::endl;
                 return keyvalue_list[i][1];
             }
@@ -287,221 +342,96 @@ public:
     };
     inline void store(const uint160_t &address, const uint256_t &key, const uint256_t& value) {
         if (std::getenv("EVM_DEBUG")) std::cout << "debug: store " << address << " " << key << " " << value << std::endl;
-        for (uint64_t i = 0; i < keyvalue_size; i++) {
-            if (keyvalue_list[i][0] == key && address == account_index[keyvalue_index[i]]) {
+        uint64_t index = locate(address);
+        for (uint64_t i = index < account_size ? account_first[index] : L; i < L; i = keyvalue_next[i]) {
+            if (keyvalue_list[i][0] == key) {
                 keyvalue_list[i][1] = value;
                 return;
             }
         }
-        uint64_t index = account_size;
-        for (uint64_t i = 0; i < account_size; i++) {
-            if (address == account_index[i]) {
-                index = i;
-                break;
-            }
-        }
         if (index == account_size) {
             assert(account_size < L);
+            account_index[account_size] = address;
             account_list[account_size].nonce = 0;
             account_list[account_size].balance = 0;
             account_list[account_size].codehash = 0;
+            account_first[account_size] = L;
             account_size++;
         }
         assert (keyvalue_size < L);
         keyvalue_index[keyvalue_size] = index;
         keyvalue_list[keyvalue_size][0] = key;
         keyvalue_list[keyvalue_size][1] = value;
+        link(keyvalue_size);
         keyvalue_size++;
     };
     inline void clear(const uint160_t &address) {
         if (std::getenv("EVM_DEBUG")) std::cout << "debug: clear " << address << std::endl;
-        for (uint64_t i = 0; i < keyvalue_size; i++) {
-            if (address == account_index[keyvalue_index[i]]) {
-                keyvalue_size--;
-                if (i < keyvalue_size) {
-                    keyvalue_index[i] = keyvalue_index[keyvalue_size];
-                    keyvalue_list[i][0] = keyvalue_list[keyvalue_size][0];
-                    keyvalue_list[i][1] = keyvalue_list[keyvalue_size][1];
-                }
-            }
-        }
+        uint64_t index = locate(address);
+        if (index == account_size) return;
+        while (account_first[index] < L) erase(account_first[index]);
     }
     inline void remove(const uint160_t &address) {
         if (std::getenv("EVM_DEBUG")) std::cout << "debug: remove " << address << std::endl;
-        for (uint64_t i = 0; i < account_size; i++) {
-            if (address == account_index[i]) {
-                account_size--;
-                if (i < account_size) {
-                    account_index[i] = account_index[account_size];
-                    account_list[i].nonce = account_list[account_size].nonce;
-                    account_list[i].balance = account_list[account_size].balance;
-                    account_list[i].codehash = account_list[account_size].codehash;
-                }
-                return;
-            }
+        uint64_t index = locate(address);
+        if (index == account_size) return;
+        // the slots go with the account, the last account takes its place
+        while (account_first[index] < L) erase(account_first[index]);
+        account_size--;
+        if (index < account_size) {
+            account_index[index] = account_index[account_size];
+            account_list[index].nonce = account_list[account_size].nonce;
+            account_list[index].balance = account_list[account_size].balance;
+            account_list[index].codehash = account_list[account_size].codehash;
+            account_first[index] = account_first[account_size];
+            for (uint64_t i = account_first[index]; i < L; i = keyvalue_next[i]) keyvalue_index[i] = index;
         }
     }
+    void append_log(const uint160_t &address, const uint256_t *topics, uint64_t count, const uint8_t *data, uint64_t data_size) {
+        uint64_t bound = data_size + count * (1 + 32) + (1 + 20) + 3 * (1 + 8);
+        uint64_t offset = logs.size();
+        logs.resize(offset + bound);
+        _try({
+            uint64_t size = _catches(encode_log)(address, topics, count, data, data_size, &logs[offset], bound);
+            std::memmove(&logs[offset], &logs[offset + bound - size], size);
+            logs.resize(offset + size);
+        }, Error e, {
+            assert(false);
+        })
+    }
     inline void log0(const uint160_t &address, const uint8_t *data, uint64_t data_size) {
         if (std::getenv("EVM_DEBUG")) std::cout << "log0 " << address << std::endl;
-        struct rlp *new_list = _new<struct rlp>(logs.size + 1);
-        for (uint64_t i = 0; i < logs.size; i++) new_list[i] = logs.list[i];
-        _delete(logs.list);
-        logs.list = new_list;
-        logs.size++;
-        struct rlp *rlp = &logs.list[logs.size-1];
-        rlp->is_list = true;
-        rlp->size = 3;
-        rlp->list = _new<struct rlp>(rlp->size);
-        rlp->list[0].is_list = false;
-        rlp->list[0].size = 20;
-        rlp->list[0].data = _new<uint8_t>(rlp->list[0].size);
-        uint160_t::to(address, rlp->list[0].data);
-        rlp->list[1].is_list = true;
-        rlp->list[1].size = 0;
-        rlp->list[1].list = nullptr;
-        rlp->list[2].is_list = false;
-        rlp->list[2].size = data_size;
-        rlp->list[2].data = _new<uint8_t>(rlp->list[2].size);
-        for (uint64_t i = 0; i < data_size; i++) rlp->list[2].data[i] = data[i];
+        append_log(address, nullptr, 0, data, data_size);
     }
     inline void log1(const uint160_t &address, const uint256_t &v1, const uint8_t *data, uint64_t data_size) {
         if (std::getenv("EVM_DEBUG")) std::cout << "log1 " << address << " " << v1 << std::endl;
-        struct rlp *new_list = _new<struct rlp>(logs.size + 1);
-        for (uint64_t i = 0; i < logs.size; i++) new_list[i] = logs.list[i];
-        _delete(logs.list);
-        logs.list = new_list;
-        logs.size++;
-        struct rlp *rlp = &logs.list[logs.size-1];
-        rlp->is_list = true;
-        rlp->size = 3;
-        rlp->list = _new<struct rlp>(rlp->size);
-        rlp->list[0].is_list = false;
-        rlp->list[0].size = 20;
-        rlp->list[0].data = _new<uint8_t>(rlp->list[0].size);
-        uint160_t::to(address, rlp->list[0].data);
-        rlp->list[1].is_list = true;
-        rlp->list[1].size = 1;
-        rlp->list[1].list = _new<struct rlp>(rlp->list[1].size);
-        rlp->list[1].list[0].is_list = false;
-        rlp->list[1].list[0].size = 32;
-        rlp->list[1].list[0].data = _new<uint8_t>(rlp->list[1].list[0].size);
-        uint256_t::to(v1, rlp->list[1].list[0].data);
-        rlp->list[2].is_list = false;
-        rlp->list[2].size = data_size;
-        rlp->list[2].data = _new<uint8_t>(rlp->list[2].size);
-        for (uint64_t i = 0; i < data_size; i++) rlp->list[2].data[i] = data[i];
+        const uint256_t topics[1] = {v1};
+        append_log(address, topics, 1, data, data_size);
     }
     inline void log2(const uint160_t &address, const uint256_t &v1, const uint256_t &v2, const uint8_t *data, uint64_t data_size) {
         if (std::getenv("EVM_DEBUG")) std::cout << "log2 " << address << " " << v1 << " " << v2 << std::endl;
-        struct rlp *new_list = _new<struct rlp>(logs.size + 1);
-        for (uint64_t i = 0; i < logs.size; i++) new_list[i] = logs.list[i];
-        _delete(logs.list);
-        logs.list = new_list;
-        logs.size++;
-        struct rlp *rlp = &logs.list[logs.size-1];
-        rlp->is_list = true;
-        rlp->size = 3;
-        rlp->list = _new<struct rlp>(rlp->size);
-        rlp->list[0].is_list = false;
-        rlp->list[0].size = 20;
-        rlp->list[0].data = _new<uint8_t>(rlp->list[0].size);
-        uint160_t::to(address, rlp->list[0].data);
-        rlp->list[1].is_list = true;
-        rlp->list[1].size = 2;
-        rlp->list[1].list = _new<struct rlp>(rlp->list[1].size);
-        rlp->list[1].list[0].is_list = false;
-        rlp->list[1].list[0].size = 32;
-        rlp->list[1].list[0].data = _new<uint8_t>(rlp->list[1].list[0].size);
-        uint256_t::to(v1, rlp->list[1].list[0].data);
-        rlp->list[1].list[1].is_list = false;
-        rlp->list[1].list[1].size = 32;
-        rlp->list[1].list[1].data = _new<uint8_t>(rlp->list[1].list[1].size);
-        uint256_t::to(v2, rlp->list[1].list[1].data);
-        rlp->list[2].is_list = false;
-        rlp->list[2].size = data_size;
-        rlp->list[2].data = _new<uint8_t>(rlp->list[2].size);
-        for (uint64_t i = 0; i < data_size; i++) rlp->list[2].data[i] = data[i];
+        const uint256_t topics[2] = {v1, v2};
+        append_log(address, topics, 2, data, data_size);
     }
     inline void log3(const uint160_t &address, const uint256_t &v1, const uint256_t &v2, const uint256_t &v3, const uint8_t *data, uint64_t data_size) {
         if (std::getenv("EVM_DEBUG")) std::cout << "log3 " << address << " " << v1 << " " << v2 << " " << v3 << std::endl;
-        struct rlp *new_list = _new<struct rlp>(logs.size + 1);
-        for (uint64_t i = 0; i < logs.size; i++) new_list[i] = logs.list[i];
-        _delete(logs.list);
-        logs.list = new_list;
-        logs.size++;
-        struct rlp *rlp = &logs.list[logs.size-1];
-        rlp->is_list = true;
-        rlp->size = 3;
-        rlp->list = _new<struct rlp>(rlp->size);
-        rlp->list[0].is_list = false;
-        rlp->list[0].size = 20;
-        rlp->list[0].data = _new<uint8_t>(rlp->list[0].size);
-        uint160_t::to(address, rlp->list[0].data);
-        rlp->list[1].is_list = true;
-        rlp->list[1].size = 3;
-        rlp->list[1].list = _new<struct rlp>(rlp->list[1].size);
-        rlp->list[1].list[0].is_list = false;
-        rlp->list[1].list[0].size = 32;
-        rlp->list[1].list[0].data = _new<uint8_t>(rlp->list[1].list[0].size);
-        uint256_t::to(v1, rlp->list[1].list[0].data);
-        rlp->list[1].list[1].is_list = false;
-        rlp->list[1].list[1].size = 32;
-        rlp->list[1].list[1].data = _new<uint8_t>(rlp->list[1].list[1].size);
-        uint256_t::to(v2, rlp->list[1].list[1].data);
-        rlp->list[1].list[2].is_list = false;
-        rlp->list[1].list[2].size = 32;
-        rlp->list[1].list[2].data = _new<uint8_t>(rlp->list[1].list[2].size);
-        uint256_t::to(v3, rlp->list[1].list[2].data);
-        rlp->list[2].is_list = false;
-        rlp->list[2].size = data_size;
-        rlp->list[2].data = _new<uint8_t>(rlp->list[2].size);
-        for (uint64_t i = 0; i < data_size; i++) rlp->list[2].data[i] = data[i];
+        const uint256_t topics[3] = {v1, v2, v3};
+        append_log(address, topics, 3, data, data_size);
     }
     inline void log4(const uint160_t &address, const uint256_t &v1, const uint256_t &v2, const uint256_t &v3, const uint256_t &v4, const uint8_t *data, uint64_t data_size) {
         if (std::getenv("EVM_DEBUG")) std::cout << "log4 " << address << " " << v1 << " " << v2 << " " << v3 << " " << v4 << std::endl;
-        struct rlp *new_list = _new<struct rlp>(logs.size + 1);
-        for (uint64_t i = 0; i < logs.size; i++) new_list[i] = logs.list[i];
-        _delete(logs.list);
-        logs.list = new_list;
-        logs.size++;
-        struct rlp *rlp = &logs.list[logs.size-1];
-        rlp->is_list = true;
-        rlp->size = 3;
-        rlp->list = _new<struct rlp>(rlp->size);
-        rlp->list[0].is_list = false;
-        rlp->list[0].size = 20;
-        rlp->list[0].data = _new<uint8_t>(rlp->list[0].size);
-        uint160_t::to(address, rlp->list[0].data);
-        rlp->list[1].is_list = true;
-        rlp->list[1].size = 4;
-        rlp->list[1].list = _new<struct rlp>(rlp->list[1].size);
-        rlp->list[1].list[0].is_list = false;
-        rlp->list[1].list[0].size = 32;
-        rlp->list[1].list[0].data = _new<uint8_t>(rlp->list[1].list[0].size);
-        uint256_t::to(v1, rlp->list[1].list[0].data);
-        rlp->list[1].list[1].is_list = false;
-        rlp->list[1].list[1].size = 32;
-        rlp->list[1].list[1].data = _new<uint8_t>(rlp->list[1].list[1].size);
-        uint256_t::to(v2, rlp->list[1].list[1].data);
-        rlp->list[1].list[2].is_list = false;
-        rlp->list[1].list[2].size = 32;
-        rlp->list[1].list[2].data = _new<uint8_t>(rlp->list[1].list[2].size);
-        uint256_t::to(v3, rlp->list[1].list[2].data);
-        rlp->list[1].list[3].is_list = false;
-        rlp->list[1].list[3].size = 32;
-        rlp->list[1].list[3].data = _new<uint8_t>(rlp->list[1].list[3].size);
-        uint256_t::to(v4, rlp->list[1].list[3].data);
-        rlp->list[2].is_list = false;
-        rlp->list[2].size = data_size;
-        rlp->list[2].data = _new<uint8_t>(rlp->list[2].size);
-        for (uint64_t i = 0; i < data_size; i++) rlp->list[2].data[i] = data[i];
+        const uint256_t topics[4] = {v1, v2, v3, v4};
+        append_log(address, topics, 4, data, data_size);
     }
     uint256_t loghash() {
         _try({
-            uint64_t size = _catches(dump_rlp)(logs, nullptr, 0);
-            local<uint8_t> buffer_l(size); uint8_t *buffer = buffer_l.data;
-            _catches(dump_rlp)(logs, buffer, size);
-            return sha3(buffer, size);
+            const uint64_t H = 1 + 8;
+            uint8_t header[H];
+            uint64_t header_size = _catches(dump_varlen)(0xc0, 0, logs.size(), header, H);
+            Keccak256 keccak;
+            keccak.absorb(&header[H - header_size], header_size);
+            keccak.absorb(logs.data(), logs.size());
+            return keccak.finish();
         }, Error e, {
             assert(false);
         })
@@ -591,15 +521,257 @@ static inline bool parse_hex(const char *hexstr, uint8_t *buffer, uint64_t size)
     return true;
 }
 
+// decodes a hex encoded raw transaction into a newly allocated buffer
+static bool parse_raw(const char *hexstr, std::vector<uint8_t> &raw)
+{
+    uint64_t len = std::strlen(hexstr);
+    if (len % 2 > 0) return false;
+    raw.resize(len / 2);
+    return parse_hex(hexstr, raw.data(), raw.size());
+}
+
+// a pipeline for executing a batch of raw transactions
+// a pool of workers decodes, verifies, hashes and recovers the senders
+// in chunks, so that the recovery shares inversions, see recover_senders,
+// while the calling thread executes the transactions in order
+// workers and executor communicate through a bounded ring of slots, a
+// slot is claimed by a worker and published by storing its sequence
+// number, the executor releases it by advancing the head, no locks involved
+// transactions with r = 0 and s = 0 run on behalf of the alternate sender
+// and the others on behalf of their recovered sender, unlike single mode
+class Pipeline {
+private:
+    static constexpr uint64_t CHUNK = 16;
+    static constexpr uint64_t SLOTS = 64 * CHUNK;
+    struct slot {
+        std::atomic<uint64_t> seq;
+        struct txn txn;
+        uint160_t sender;
+        Error error;
+    };
+    Block &block;
+    State &state;
+    const std::vector<std::vector<uint8_t>> &raws;
+    uint160_t alternate;
+    bool pays_gas;
+    std::vector<slot> slots;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> head;
+    void prepare(uint64_t base, uint64_t count) {
+        Release release = get_release(block.forknumber());
+        struct txn txns[CHUNK];
+        uint160_t senders[CHUNK];
+        Error failures[CHUNK];
+        uint64_t index[CHUNK];
+        uint64_t size = 0;
+        for (uint64_t i = base; i < base + count; i++) {
+            struct slot &slot = slots[i % SLOTS];
+            slot.txn = {0, 0, 0, false, 0, 0, nullptr, 0, false, 0, 0, 0, nullptr, 0, 0};
+            slot.sender = 0;
+            slot.error = NONE;
+            _try({
+                _catches(decode_txn)(raws[i].data(), raws[i].size(), slot.txn);
+                _catches(verify_txn)(release, slot.txn);
+                if (slot.txn.is_signed && slot.txn.r == 0 && slot.txn.s == 0) {
+                    slot.sender = alternate;
+                } else {
+                    txns[size] = slot.txn;
+                    index[size] = i;
+                    size++;
+                }
+            }, Error e, {
+                slot.error = e;
+            })
+        }
+        recover_senders(release, txns, size, senders, failures);
+        for (uint64_t j = 0; j < size; j++) {
+            struct slot &slot = slots[index[j] % SLOTS];
+            slot.sender = senders[j];
+            slot.error = failures[j];
+        }
+        for (uint64_t i = base; i < base + count; i++) {
+            slots[i % SLOTS].seq.store(i + 1, std::memory_order_release);
+        }
+    }
+    void work() {
+        uint64_t total = raws.size();
+        uint64_t chunk = CHUNK, capacity = SLOTS;
+        for (;;) {
+            uint64_t base = tail.fetch_add(chunk, std::memory_order_relaxed);
+            if (base >= total) break;
+            uint64_t count = _min(chunk, total - base);
+            while (base + count > head.load(std::memory_order_acquire) + capacity) std::this_thread::yield();
+            prepare(base, count);
+        }
+    }
+public:
+    Pipeline(Block &block, State &state, const std::vector<std::vector<uint8_t>> &raws, uint160_t alternate, bool pays_gas)
+        : block(block), state(state), raws(raws), alternate(alternate), pays_gas(pays_gas), slots(SLOTS), tail(0), head(0) {
+        for (uint64_t i = 0; i < SLOTS; i++) slots[i].seq.store(0, std::memory_order_relaxed);
+    }
+    // runs the batch reporting the outcome of each transaction
+    void run(uint64_t threads, std::vector<Error> &results) {
+        uint64_t total = raws.size();
+        results.assign(total, NONE);
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        try {
+            for (uint64_t t = 0; t < threads; t++) workers.push_back(std::thread(&Pipeline::work, this));
+        } catch (const std::system_error &) {
+            // runs with the workers started, if any
+        }
+        for (uint64_t i = 0; i < total; i++) {
+            struct slot &slot = slots[i % SLOTS];
+            // without workers the executor prepares the next chunk itself
+            if (workers.empty() && slot.seq.load(std::memory_order_acquire) != i + 1) {
+                uint64_t base = tail.fetch_add(CHUNK, std::memory_order_relaxed);
+                prepare(base, _min(CHUNK, total - base));
+            }
+            while (slot.seq.load(std::memory_order_acquire) != i + 1) std::this_thread::yield();
+            Error error = slot.error;
+            if (error == NONE) {
+                _try({
+                    _catches(vm_txn)(block, state, slot.txn, slot.sender, pays_gas);
+                }, Error e, {
+                    error = e;
+                })
+            }
+            results[i] = error;
+            _delete(slot.txn.data);
+            head.store(i + 1, std::memory_order_release);
+        }
+        for (uint64_t t = 0; t < workers.size(); t++) workers[t].join();
+    }
+};
+
+// executes a batch of hex encoded transactions given as arguments
+// or one per line from the standard input if "-" is given instead
+static int batch(const char *progname, int argc, const char *argv[])
+{
+    std::vector<std::vector<uint8_t>> raws;
+    std::vector<std::string> lines;
+    if (argc == 3 && std::strcmp(argv[2], "-") == 0) {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            line = trim(line);
+            if (line.size() > 0) lines.push_back(line);
+        }
+    } else {
+        for (int i = 2; i < argc; i++) lines.push_back(argv[i]);
+    }
+    raws.resize(lines.size());
+    for (uint64_t i = 0; i < lines.size(); i++) {
+        if (!parse_raw(lines[i].c_str(), raws[i])) { std::cerr << progname << ": invalid input " << i << std::endl; return 1; }
+    }
+    uint64_t threads = std::thread::hardware_concurrency();
+    if (threads > 1) threads--; // leaves a core for execution
+    if (threads == 0) threads = 1;
+    // the state cache outlives the transactions of the batch and is bounded
+    // by setting EVM_STATE_CACHE to a budget in bytes, or to "on" for 16M,
+    // otherwise each transaction starts with empty caches
+    uint64_t budget = 0;
+    const char *cache = std::getenv("EVM_STATE_CACHE");
+    if (cache != nullptr && *cache != '\0' && std::strcmp(cache, "off") != 0) {
+        char *end = nullptr;
+        if (std::strcmp(cache, "on") == 0) { budget = 16 * 1024 * 1024; end = (char*)cache + 2; }
+        else budget = std::strtoull(cache, &end, 0);
+        if (end == cache || *end != '\0' || budget == 0) { std::cerr << progname << ": invalid EVM_STATE_CACHE" << std::endl; return 1; }
+    }
+    _Block block;
+    _State state;
+    CachedState cached(&state);
+    cached.configure(budget);
+    std::vector<Error> results;
+    Pipeline pipeline(block, budget > 0 ? (State&)cached : (State&)state, raws, 65535, false);
+    pipeline.run(threads, results);
+    state.save();
+    if (std::getenv("EVM_DEBUG")) {
+        SenderCache::stats stats = sender_cache.get_stats();
+        std::cout << std::dec << "debug: sender cache"
+                  << " hits " << stats.hits
+                  << " misses " << stats.misses
+                  << " inserts " << stats.inserts
+                  << " evictions " << stats.evictions
+                  << " collisions " << stats.collisions << std::endl;
+        Sha3Cache::stats sha3_stats = sha3_cache.get_stats();
+        std::cout << std::dec << "debug: sha3 cache"
+                  << " hits " << sha3_stats.hits
+                  << " misses " << sha3_stats.misses
+                  << " inserts " << sha3_stats.inserts
+                  << " evictions " << sha3_stats.evictions << std::endl;
+        PrecompileCache::stats precompile_stats = precompile_cache.get_stats();
+        std::cout << std::dec << "debug: precompile cache"
+                  << " hits " << precompile_stats.hits
+                  << " misses " << precompile_stats.misses
+                  << " inserts " << precompile_stats.inserts
+                  << " evictions " << precompile_stats.evictions << std::endl;
+        if (budget > 0) {
+            CachedState::stats state_stats = cached.get_stats();
+            const char *names[4] = { "nonce", "balance", "codehash", "data" };
+            const CacheStats *counters[4] = { &state_stats.nonce, &state_stats.balance, &state_stats.codehash, &state_stats.data };
+            for (int i = 0; i < 4; i++) {
+                std::cout << std::dec << "debug: state " << names[i] << " cache"
+                          << " hits " << counters[i]->hits
+                          << " misses " << counters[i]->misses
+                          << " inserts " << counters[i]->inserts
+                          << " evictions " << counters[i]->evictions << std::endl;
+            }
+        }
+    }
+    int status = 0;
+    for (uint64_t i = 0; i < results.size(); i++) {
+        if (results[i] == NONE) continue;
+        std::cerr << progname << ": transaction " << i << " error " << errors[results[i]] << std::endl;
+        status = 1;
+    }
+    return status;
+}
+
 int main(int argc, const char *argv[])
 {
     const char *progname = argv[0];
-    if (argc < 2) { std::cerr << "usage: " << progname << " <hex>" << std::endl; return 1; }
+    if (argc < 2) { std::cerr << "usage: " << progname << " <hex> | -b <hex>... | -b -" << std::endl; return 1; }
+    // the state maps hash their keys with a random seed, so that keys can not
+    // be picked to collide, or with the one in EVM_HASH_SEED to reproduce a
+    // run, results do not depend on it
+    const char *seed = std::getenv("EVM_HASH_SEED");
+    if (seed != nullptr && *seed != '\0') {
+        char *end = nullptr;
+        hash_seed = std::strtoull(seed, &end, 0);
+        if (end == seed || *end != '\0') { std::cerr << progname << ": invalid EVM_HASH_SEED" << std::endl; return 1; }
+    } else {
+        std::random_device device;
+        hash_seed = (uint64_t)device() << 32 | device();
+    }
+    // the SHA3 memo is enabled by setting EVM_SHA3_CACHE to txn or global
+    const char *lifetime = std::getenv("EVM_SHA3_CACHE");
+    if (lifetime != nullptr && *lifetime != '\0' && std::strcmp(lifetime, "off") != 0) {
+        if (std::strcmp(lifetime, "txn") == 0) sha3_cache.set_lifetime(Sha3Cache::TRANSACTION);
+        else if (std::strcmp(lifetime, "global") == 0) sha3_cache.set_lifetime(Sha3Cache::GLOBAL);
+        else { std::cerr << progname << ": invalid EVM_SHA3_CACHE" << std::endl; return 1; }
+    }
+    // the precompile cache is enabled by setting EVM_PRECOMPILE_CACHE to a
+    // mask of contract ids, or to "on" for the expensive ones, optionally
+    // followed by a colon and the budget in bytes, 1M by default, 1G at most
+    const char *precompiles = std::getenv("EVM_PRECOMPILE_CACHE");
+    if (precompiles != nullptr && *precompiles != '\0' && std::strcmp(precompiles, "off") != 0) {
+        char *end = nullptr;
+        uint64_t mask = PrecompileCache::EXPENSIVE, budget = 1024 * 1024;
+        errno = 0;
+        if (std::strncmp(precompiles, "on", 2) == 0) end = (char*)precompiles + 2;
+        else mask = std::strtoull(precompiles, &end, 0);
+        if (*end == ':') budget = std::strtoull(end + 1, &end, 0);
+        if (end == precompiles || *end != '\0' || errno == ERANGE) { std::cerr << progname << ": invalid EVM_PRECOMPILE_CACHE" << std::endl; return 1; }
+        precompile_cache.configure(mask, budget);
+    }
+    if (std::strcmp(argv[1], "-b") == 0) return batch(progname, argc, argv);
     const char *hexstr = argv[1];
     int len = std::strlen(hexstr);
     uint64_t size = len / 2;
     local<uint8_t> buffer_l(size); uint8_t *buffer = buffer_l.data;
     if (len % 2 > 0 || !parse_hex(hexstr, buffer, size)) { std::cerr << progname << ": invalid input" << std::endl; return 1; }
+    // single mode runs the transaction on behalf of the alternate sender,
+    // whatever its signature, unlike batch mode
     _try({
         _Block block;
         _State state;
@@ -1,8 +1,18 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <atomic>
 #include <new>
 #include <vector>
+#if !defined(NATIVE_CRYPTO) && defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#if !defined(NATIVE_CRYPTO) && defined(__linux__)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
 
 #ifndef NDEBUG
 #include <cstdlib>
@@ -118,6 +128,24 @@ public:
 static inline uint64_t _min(uint64_t v1, uint64_t v2) { return v1 < v2 ? v1 : v2; }
 static inline uint64_t _max(uint64_t v1, uint64_t v2) { return v1 > v2 ? v1 : v2; }
 
+// keyed mix of the fold hash, multiplies to 128 bits and xors the halves
+// every bit of the operands reaches the low bits used to index tables, so
+// that flipping the high bits of a limb does not cancel out across limbs
+static inline uint64_t _mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 uint128_t;
+    uint128_t r = (uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t m = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    uint64_t lo = (m << 32) | (uint32_t)p00;
+    uint64_t hi = p11 + (p01 >> 32) + (p10 >> 32) + (m >> 32);
+    return lo ^ hi;
+#endif
+}
+
 // ** bigint **
 
 // a class to support arbitrary length unsigned integers
@@ -164,6 +192,8 @@ public:
     bigint() {}
     ~bigint() { _delete(data); }
     bigint(uint64_t v) { ensure(2); data[0] = v; data[1] = v >> 32; }
+    // from a table of 32-bit words (little endian), used for constants
+    bigint(const uint32_t *words, uint64_t size) { ensure(size); for (uint64_t i = 0; i < size; i++) data[i] = words[i]; pack(); }
     bigint(const bigint &v) {
         ensure(v.W);
         for (uint64_t i = 0; i < v.W; i++) data[i] = v.data[i];
@@ -400,17 +430,6 @@ public:
 #endif // NDEBUG
 };
 
-// reads bigint from decimal string
-static bigint big(const char *s)
-{
-    bigint t = 0;
-    for (uint64_t i = 0; s[i] != '\0'; i++) {
-        assert(s[i] >= '0' && s[i] <= '9');
-        t = 10 * t + (s[i] - '0');
-    }
-    return t;
-}
-
 #ifdef NATIVE_CRYPTO
 static bigint bigmodexp(const bigint& base, const bigint& exp, const bigint& mod);
 #else
@@ -434,8 +453,8 @@ struct U {
     U<L> lo; // lower word defined recursivelly (little endian)
     U<H> hi; // higher word, ditto
     inline U() {}
-    U(uint64_t v) : lo(v), hi(0) {}
-    U(const U<L>& _lo, const U<H>& _hi) : lo(_lo), hi(_hi) {}
+    constexpr U(uint64_t v) : lo(v), hi(0) {}
+    constexpr U(const U<L>& _lo, const U<H>& _hi) : lo(_lo), hi(_hi) {}
     template<int M> U(const U<M>& v) : U<N>(v, 0) {}
     template<int M> U(const U<M>& v, uint64_t base) : lo(v, base), hi(v, base + L/32) {}
 
@@ -825,6 +844,11 @@ struct U {
         return h;
     }
 
+    // multiplicative hash function
+    // folds the 64-bit limbs into the seed with a keyed mix each
+    // much cheaper than murmur3 and as good for tables indexed by low bits
+    uint64_t fold(uint64_t seed) const { return lo.fold(hi.fold(seed)); }
+
 #ifndef NDEBUG
     friend std::ostream& operator<<(std::ostream &os, const U &v) {
         os << v.hi << ":" << v.lo;
@@ -838,7 +862,7 @@ template <>
 struct U<64> {
     uint64_t n; // the actual 64-bit number
     inline U() {}
-    inline U(uint64_t _n) : n(_n) {}
+    constexpr U(uint64_t _n) : n(_n) {}
     template<int M> inline U(const U<M>& v) : U<64>(v, 0) {}
     template<int M> inline U(const U<M>& v, uint64_t base) : U<64>(base < M/32 ? v.word(base) : 0, base + 1 < M/32 ? v.word(base + 1) : 0) {}
     inline U(uint32_t n1, uint32_t n2) : n((uint64_t)n2 << 32 | (uint64_t)n1) {}
@@ -1184,6 +1208,7 @@ struct U<64> {
         h ^= h >> 16;
         return h;
     }
+    uint64_t fold(uint64_t seed) const { return _mum(seed ^ n, 0x9e3779b97f4a7c15L); }
 
 #ifndef NDEBUG
     friend std::ostream& operator<<(std::ostream &os, U v) {
@@ -1202,7 +1227,7 @@ template <>
 struct U<32> {
     uint32_t n; // the actual 32-bit number
     inline U() {}
-    inline U(uint32_t _n) : n(_n) {}
+    constexpr U(uint32_t _n) : n(_n) {}
     template<int M> inline U(const U<M>& v) : U<32>(v, 0) {}
     template<int M> inline U(const U<M>& v, uint64_t base) : n(base < M/32 ? v.word(base) : 0) {}
 
@@ -1510,6 +1535,7 @@ struct U<32> {
         h ^= h >> 16;
         return h;
     }
+    uint64_t fold(uint64_t seed) const { return _mum(seed ^ n, 0x9e3779b97f4a7c15L); }
 
 #ifndef NDEBUG
     friend std::ostream& operator<<(std::ostream &os, U v) {
@@ -1550,8 +1576,8 @@ static U<N> uhex(const char *s)
 struct uint160_t : public U<160> {
 public:
     inline uint160_t() {}
-    inline uint160_t(uint64_t v) : U(v) {}
-    inline uint160_t(const U& v) : U(v) {}
+    constexpr uint160_t(uint64_t v) : U(v) {}
+    constexpr uint160_t(const U& v) : U(v) {}
 };
 static inline uint160_t udec160(const char *s) { return udec<160>(s); }
 static inline uint160_t uhex160(const char *s) { return uhex<160>(s); }
@@ -1561,11 +1587,13 @@ static inline uint160_t uhex160(const char *s) { return uhex<160>(s); }
 struct uint256_t : public U<256> {
 public:
     inline uint256_t() {}
-    inline uint256_t(uint64_t v) : U(v) {}
-    inline uint256_t(const U& v) : U(v) {}
+    constexpr uint256_t(uint64_t v) : U(v) {}
+    constexpr uint256_t(const U& v) : U(v) {}
 };
 static inline uint256_t udec256(const char *s) { return udec<256>(s); }
 static inline uint256_t uhex256(const char *s) { return uhex<256>(s); }
+// compile-time 256-bit constant from 64-bit words, most significant first
+static constexpr uint256_t u256(uint64_t w3, uint64_t w2, uint64_t w1, uint64_t w0) { return U<256>(U<128>(U<64>(w0), U<64>(w1)), U<128>(U<64>(w2), U<64>(w3))); }
 
 // 416-bit instance of U<N>
 // used to represent storage locations as a combination of
@@ -1573,8 +1601,8 @@ static inline uint256_t uhex256(const char *s) { return uhex<256>(s); }
 struct uint416_t : public U<416> {
 public:
     inline uint416_t() {}
-    inline uint416_t(uint64_t v) : U(v) {}
-    inline uint416_t(const U& v) : U(v) {}
+    constexpr uint416_t(uint64_t v) : U(v) {}
+    constexpr uint416_t(const U& v) : U(v) {}
 };
 static inline uint416_t udec416(const char *s) { return udec<416>(s); }
 static inline uint416_t uhex416(const char *s) { return uhex<416>(s); }
@@ -1582,7 +1610,6 @@ static inline uint416_t uhex416(const char *s) { return uhex<416>(s); }
 // ** hashing **
 
 // sha3 256-bit implementation (keccak flavor) and auxiliary functions
-static inline uint64_t rot(uint64_t x, int y) { return y > 0 ? (x >> (64 - y)) ^ (x << y) : x; }
 static inline uint64_t b2w64le(const uint8_t *b)
 {
     return 0
@@ -1606,102 +1633,297 @@ static inline void w2b64le(uint64_t w, uint8_t *b)
     b[6] = (uint8_t)(w >> 48);
     b[7] = (uint8_t)(w >> 56);
 }
-static void sha3(const uint8_t *message, uint64_t size, bool compressed, uint64_t r, uint8_t eof, uint8_t *output)
+#ifdef NATIVE_CRYPTO
+static uint256_t sha3(const uint8_t *buffer, uint64_t size);
+// incremental sha3 256-bit hashing (keccak flavor)
+// with native crypto the data is gathered and hashed at once by the host
+class Keccak256 {
+private:
+    std::vector<uint8_t> buffer;
+public:
+    void absorb(const uint8_t *data, uint64_t size) { buffer.insert(buffer.end(), data, data + size); }
+    uint256_t finish() { return sha3(buffer.data(), buffer.size()); }
+};
+// hashes count messages at once, results[i] = sha3(messages[i], sizes[i])
+static void sha3(const uint8_t *const *messages, const uint64_t *sizes, uint64_t count, uint256_t *results)
 {
-    if (!compressed) {
-        uint64_t bitsize = 8 * size;
-        uint64_t padding = (r - bitsize % r) / 8;
-        uint64_t b_len = size + padding;
-        local<uint8_t> b_l(b_len); uint8_t *b = b_l.data;
-        for (uint64_t i = 0; i < size; i++) b[i] = message[i];
-        for (uint64_t i = size; i < b_len; i++) b[i] = 0;
-        b[size] |= eof;
-        b[b_len-1] |= 0x80;
-        sha3(b, b_len, true, r, eof, output);
+    for (uint64_t i = 0; i < count; i++) results[i] = sha3(messages[i], sizes[i]);
+}
+#else
+// keccak-f[1600] permutation over the 25 lanes state, lane x + 5 * y
+// rounds are unrolled in pairs, the second one writing back into the state
+// by default some lanes are kept complemented during the rounds so that
+// chi needs one not per plane instead of five, see keccak_chi
+// with bmi the and-not instruction makes plain chi cheaper, therefore on
+// x86-64 a bmi variant is selected at startup when the cpu supports it
+// the round templates are forced inline so that each variant is compiled
+// entirely for its target extension
+static const uint64_t keccak_RC[24] = {
+    0x0000000000000001L, 0x0000000000008082L, 0x800000000000808aL,
+    0x8000000080008000L, 0x000000000000808bL, 0x0000000080000001L,
+    0x8000000080008081L, 0x8000000000008009L, 0x000000000000008aL,
+    0x0000000000000088L, 0x0000000080008009L, 0x000000008000000aL,
+    0x000000008000808bL, 0x800000000000008bL, 0x8000000000008089L,
+    0x8000000000008003L, 0x8000000000008002L, 0x8000000000000080L,
+    0x000000000000800aL, 0x800000008000000aL, 0x8000000080008081L,
+    0x8000000000008080L, 0x0000000080000001L, 0x8000000080008008L,
+};
+// the lane type T is either a 64-bit word or a vector of words, one per
+// message, for the multi-buffer hashing below, hence rol works in place
+template<typename T>
+static inline void rol(T &x, int y) { x = (x << y) | (x >> (64 - y)); }
+// chi over one plane of five lanes b, writing it at e
+// the complemented form expects the lanes 1, 2, 8, 12, 17, 20 complemented
+template<typename T, bool COMPLEMENT, int PLANE>
+static inline void keccak_chi(const T *b, T *e)
+{
+    if (!COMPLEMENT) {
+        for (int x = 0; x < 5; x++) e[x] = b[x] ^ (~b[(x + 1) % 5] & b[(x + 2) % 5]);
         return;
     }
-    static const uint64_t RC[24] = {
-        0x0000000000000001L, 0x0000000000008082L, 0x800000000000808aL,
-        0x8000000080008000L, 0x000000000000808bL, 0x0000000080000001L,
-        0x8000000080008081L, 0x8000000000008009L, 0x000000000000008aL,
-        0x0000000000000088L, 0x0000000080008009L, 0x000000008000000aL,
-        0x000000008000808bL, 0x800000000000008bL, 0x8000000000008089L,
-        0x8000000000008003L, 0x8000000000008002L, 0x8000000000000080L,
-        0x000000000000800aL, 0x800000008000000aL, 0x8000000080008081L,
-        0x8000000000008080L, 0x0000000080000001L, 0x8000000080008008L,
-    };
-    static const uint8_t R[5][5] = {
-        { 0, 36,  3, 41, 18},
-        { 1, 44, 10, 45,  2},
-        {62,  6, 43, 15, 61},
-        {28, 55, 25, 21, 56},
-        {27, 20, 39,  8, 14},
-    };
-    uint64_t s[5][5];
-    for (int y = 0; y < 5; y++) {
-        for (int x = 0; x < 5; x++) {
-            s[x][y] = 0;
-        }
+    switch (PLANE) {
+    case 0:
+        e[0] = b[0] ^ (b[1] | b[2]);
+        e[1] = b[1] ^ (~b[2] | b[3]);
+        e[2] = b[2] ^ (b[3] & b[4]);
+        e[3] = b[3] ^ (b[4] | b[0]);
+        e[4] = b[4] ^ (b[0] & b[1]);
+        break;
+    case 1:
+        e[0] = b[0] ^ (b[1] | b[2]);
+        e[1] = b[1] ^ (b[2] & b[3]);
+        e[2] = b[2] ^ (b[3] | ~b[4]);
+        e[3] = b[3] ^ (b[4] | b[0]);
+        e[4] = b[4] ^ (b[0] & b[1]);
+        break;
+    case 2:
+        e[0] = b[0] ^ (b[1] | b[2]);
+        e[1] = b[1] ^ (b[2] & b[3]);
+        e[2] = b[2] ^ (~b[3] & b[4]);
+        e[3] = ~b[3] ^ (b[4] | b[0]);
+        e[4] = b[4] ^ (b[0] & b[1]);
+        break;
+    case 3:
+        e[0] = b[0] ^ (b[1] & b[2]);
+        e[1] = b[1] ^ (b[2] | b[3]);
+        e[2] = b[2] ^ (~b[3] | b[4]);
+        e[3] = ~b[3] ^ (b[4] & b[0]);
+        e[4] = b[4] ^ (b[0] | b[1]);
+        break;
+    case 4:
+        e[0] = b[0] ^ (~b[1] & b[2]);
+        e[1] = ~b[1] ^ (b[2] | b[3]);
+        e[2] = b[2] ^ (b[3] & b[4]);
+        e[3] = b[3] ^ (b[4] | b[0]);
+        e[4] = b[4] ^ (b[0] & b[1]);
+        break;
     }
-    uint64_t k = r / 64;
-    for (uint64_t j = 0; j < size/8; j += k) {
-        uint64_t w[25];
-        for (uint64_t i = 0; i < k; i++) {
-            w[i] = b2w64le(&message[8*(j+i)]);
-        }
-        for (int i = k; i < 25; i++) {
-            w[i] = 0;
+}
+// one round from a into e, theta, rho and pi gather each output plane
+template<typename T, bool COMPLEMENT>
+__attribute__((always_inline)) static inline void keccak_round(const T *a, T *e, uint64_t rc)
+{
+    T c0 = a[0] ^ a[5] ^ a[10] ^ a[15] ^ a[20];
+    T c1 = a[1] ^ a[6] ^ a[11] ^ a[16] ^ a[21];
+    T c2 = a[2] ^ a[7] ^ a[12] ^ a[17] ^ a[22];
+    T c3 = a[3] ^ a[8] ^ a[13] ^ a[18] ^ a[23];
+    T c4 = a[4] ^ a[9] ^ a[14] ^ a[19] ^ a[24];
+    T d0 = c1; rol(d0, 1); d0 ^= c4;
+    T d1 = c2; rol(d1, 1); d1 ^= c0;
+    T d2 = c3; rol(d2, 1); d2 ^= c1;
+    T d3 = c4; rol(d3, 1); d3 ^= c2;
+    T d4 = c0; rol(d4, 1); d4 ^= c3;
+    T b[5];
+    b[0] = a[0] ^ d0;
+    b[1] = a[6] ^ d1; rol(b[1], 44);
+    b[2] = a[12] ^ d2; rol(b[2], 43);
+    b[3] = a[18] ^ d3; rol(b[3], 21);
+    b[4] = a[24] ^ d4; rol(b[4], 14);
+    keccak_chi<T, COMPLEMENT, 0>(b, &e[0]);
+    e[0] ^= rc;
+    b[0] = a[3] ^ d3; rol(b[0], 28);
+    b[1] = a[9] ^ d4; rol(b[1], 20);
+    b[2] = a[10] ^ d0; rol(b[2], 3);
+    b[3] = a[16] ^ d1; rol(b[3], 45);
+    b[4] = a[22] ^ d2; rol(b[4], 61);
+    keccak_chi<T, COMPLEMENT, 1>(b, &e[5]);
+    b[0] = a[1] ^ d1; rol(b[0], 1);
+    b[1] = a[7] ^ d2; rol(b[1], 6);
+    b[2] = a[13] ^ d3; rol(b[2], 25);
+    b[3] = a[19] ^ d4; rol(b[3], 8);
+    b[4] = a[20] ^ d0; rol(b[4], 18);
+    keccak_chi<T, COMPLEMENT, 2>(b, &e[10]);
+    b[0] = a[4] ^ d4; rol(b[0], 27);
+    b[1] = a[5] ^ d0; rol(b[1], 36);
+    b[2] = a[11] ^ d1; rol(b[2], 10);
+    b[3] = a[17] ^ d2; rol(b[3], 15);
+    b[4] = a[23] ^ d3; rol(b[4], 56);
+    keccak_chi<T, COMPLEMENT, 3>(b, &e[15]);
+    b[0] = a[2] ^ d2; rol(b[0], 62);
+    b[1] = a[8] ^ d3; rol(b[1], 55);
+    b[2] = a[14] ^ d4; rol(b[2], 39);
+    b[3] = a[15] ^ d0; rol(b[3], 41);
+    b[4] = a[21] ^ d1; rol(b[4], 2);
+    keccak_chi<T, COMPLEMENT, 4>(b, &e[20]);
+}
+template<typename T, bool COMPLEMENT>
+__attribute__((always_inline)) static inline void keccakf_t(T *s)
+{
+    static const int L[6] = { 1, 2, 8, 12, 17, 20 };
+    T a[25], e[25];
+    for (int i = 0; i < 25; i++) a[i] = s[i];
+    if (COMPLEMENT) for (int i = 0; i < 6; i++) a[L[i]] = ~a[L[i]];
+    for (int j = 0; j < 24; j += 2) {
+        keccak_round<T, COMPLEMENT>(a, e, keccak_RC[j]);
+        keccak_round<T, COMPLEMENT>(e, a, keccak_RC[j + 1]);
+    }
+    if (COMPLEMENT) for (int i = 0; i < 6; i++) a[L[i]] = ~a[L[i]];
+    for (int i = 0; i < 25; i++) s[i] = a[i];
+}
+static void keccakf_generic(uint64_t *s) { keccakf_t<uint64_t, true>(s); }
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+__attribute__((target("bmi,bmi2"))) static void keccakf_bmi(uint64_t *s) { keccakf_t<uint64_t, false>(s); }
+static void (*keccakf_select())(uint64_t *)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("bmi2")) return keccakf_bmi;
+    return keccakf_generic;
+}
+static void (*const keccakf)(uint64_t *) = keccakf_select();
+#else
+static void (*const keccakf)(uint64_t *) = keccakf_generic;
+#endif
+// incremental sha3 256-bit hashing (keccak flavor)
+// data is absorbed as it arrives, only a partial block is kept around
+class Keccak256 {
+private:
+    static constexpr uint64_t RATE = 136;
+    uint64_t s[25];
+    uint8_t block[RATE];
+    uint64_t size = 0;
+    void compress(const uint8_t *b) {
+        for (uint64_t i = 0; i < RATE / 8; i++) s[i] ^= b2w64le(&b[8 * i]);
+        keccakf(s);
+    }
+public:
+    Keccak256() { for (int i = 0; i < 25; i++) s[i] = 0; }
+    void absorb(const uint8_t *data, uint64_t len) {
+        if (size > 0) {
+            while (len > 0 && size < RATE) { block[size++] = *data++; len--; }
+            if (size < RATE) return;
+            compress(block);
+            size = 0;
         }
-        for (int y = 0; y < 5; y++) {
-            for (int x = 0; x < 5; x++) {
-                s[x][y] ^= w[5 * y + x];
-            }
+        for (; len >= RATE; data += RATE, len -= RATE) compress(data);
+        for (uint64_t i = 0; i < len; i++) block[i] = data[i];
+        size = len;
+    }
+    uint256_t finish() {
+        for (uint64_t i = size; i < RATE; i++) block[i] = 0;
+        block[size] |= 0x01;
+        block[RATE - 1] |= 0x80;
+        compress(block);
+        uint8_t output[32];
+        for (int i = 0; i < 4; i++) w2b64le(s[i], &output[8 * i]);
+        return uint256_t::from(output);
+    }
+};
+// inputs shorter than a block, such as addresses and storage keys, are
+// loaded straight into the state and take a single permutation
+static uint256_t sha3(const uint8_t *buffer, uint64_t size)
+{
+    if (size >= 136) {
+        Keccak256 keccak;
+        keccak.absorb(buffer, size);
+        return keccak.finish();
+    }
+    uint64_t s[25];
+    uint64_t words = size / 8;
+    for (uint64_t i = 0; i < words; i++) s[i] = b2w64le(&buffer[8 * i]);
+    uint64_t last = 0;
+    for (uint64_t i = 8 * words; i < size; i++) last |= (uint64_t)buffer[i] << (8 * (i % 8));
+    s[words] = last ^ ((uint64_t)0x01 << (8 * (size % 8)));
+    for (uint64_t i = words + 1; i < 25; i++) s[i] = 0;
+    s[16] ^= (uint64_t)0x80 << 56;
+    keccakf(s);
+    uint8_t output[32];
+    for (int i = 0; i < 4; i++) w2b64le(s[i], &output[8 * i]);
+    return uint256_t::from(output);
+}
+// multi-buffer sha3, N messages are hashed side by side with their states
+// interleaved lane by lane into vectors of N words
+// blocks are absorbed in lockstep, a message that is over keeps permuting
+// along, its hash having been read right after its last block
+template<typename V, int N>
+__attribute__((always_inline)) static inline void sha3_t(const uint8_t *const *messages, const uint64_t *sizes, uint256_t *results)
+{
+    const uint64_t RATE = 136;
+    uint64_t blocks[N];
+    uint64_t count = 0;
+    for (int k = 0; k < N; k++) {
+        blocks[k] = sizes[k] / RATE + 1;
+        if (blocks[k] > count) count = blocks[k];
+    }
+    uint8_t last[N][RATE];
+    for (int k = 0; k < N; k++) {
+        uint64_t offset = (blocks[k] - 1) * RATE;
+        uint64_t size = sizes[k] - offset;
+        for (uint64_t i = 0; i < size; i++) last[k][i] = messages[k][offset + i];
+        for (uint64_t i = size; i < RATE; i++) last[k][i] = 0;
+        last[k][size] |= 0x01;
+        last[k][RATE - 1] |= 0x80;
+    }
+    V s[25] = {};
+    for (uint64_t j = 0; j < count; j++) {
+        for (int k = 0; k < N; k++) {
+            if (j >= blocks[k]) continue;
+            const uint8_t *b = j == blocks[k] - 1 ? last[k] : &messages[k][j * RATE];
+            for (uint64_t i = 0; i < RATE / 8; i++) s[i][k] ^= b2w64le(&b[8 * i]);
         }
-        for (int j = 0; j < 24; j++) {
-            uint64_t c[5];
-            for (int x = 0; x < 5; x++) {
-                c[x] = s[x][0] ^ s[x][1] ^ s[x][2] ^ s[x][3] ^ s[x][4];
-            }
-            uint64_t d[5];
-            for (int x = 0; x < 5; x++) {
-                d[x] = c[(x + 4) % 5] ^ rot(c[(x + 1) % 5], 1);
-            }
-            for (int x = 0; x < 5; x++) {
-                for (int y = 0; y < 5; y++) {
-                    s[x][y] ^= d[x];
-                }
-            }
-            uint64_t b[5][5];
-            for (int x = 0; x < 5; x++) {
-                for (int y = 0; y < 5; y++) {
-                    b[y][(2 * x + 3 * y) % 5] = rot(s[x][y], R[x][y]);
-                }
-            }
-            for (int x = 0; x < 5; x++) {
-                for (int y = 0; y < 5; y++) {
-                    s[x][y] = b[x][y] ^ (~b[(x + 1) % 5][y] & b[(x + 2) % 5][y]);
-                }
-            }
-            s[0][0] ^= RC[j];
+        keccakf_t<V, false>(s);
+        for (int k = 0; k < N; k++) {
+            if (j != blocks[k] - 1) continue;
+            uint8_t output[32];
+            for (int i = 0; i < 4; i++) w2b64le(s[i][k], &output[8 * i]);
+            results[k] = uint256_t::from(output);
         }
     }
-    w2b64le(s[0][0], &output[0]);
-    w2b64le(s[1][0], &output[8]);
-    w2b64le(s[2][0], &output[16]);
-    w2b64le(s[3][0], &output[24]);
-    w2b64le(s[4][0], &output[32]);
-    w2b64le(s[0][1], &output[40]);
-    w2b64le(s[1][1], &output[48]);
-    w2b64le(s[2][1], &output[56]);
 }
-#ifdef NATIVE_CRYPTO
-static uint256_t sha3(const uint8_t *buffer, uint64_t size);
+static void sha3_scalar(const uint8_t *const *messages, const uint64_t *sizes, uint64_t count, uint256_t *results)
+{
+    for (uint64_t i = 0; i < count; i++) results[i] = sha3(messages[i], sizes[i]);
+}
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+typedef uint64_t keccak_v4 __attribute__((vector_size(32)));
+typedef uint64_t keccak_v8 __attribute__((vector_size(64)));
+__attribute__((target("avx2"))) static void sha3_avx2(const uint8_t *const *messages, const uint64_t *sizes, uint64_t count, uint256_t *results)
+{
+    uint64_t i = 0;
+    for (; i + 4 <= count; i += 4) sha3_t<keccak_v4, 4>(&messages[i], &sizes[i], &results[i]);
+    sha3_scalar(&messages[i], &sizes[i], count - i, &results[i]);
+}
+// the remainder of the 8-way groups may still fill a 4-way one
+__attribute__((target("avx512f"))) static void sha3_avx512(const uint8_t *const *messages, const uint64_t *sizes, uint64_t count, uint256_t *results)
+{
+    uint64_t i = 0;
+    for (; i + 8 <= count; i += 8) sha3_t<keccak_v8, 8>(&messages[i], &sizes[i], &results[i]);
+    sha3_avx2(&messages[i], &sizes[i], count - i, &results[i]);
+}
+static void (*sha3_select())(const uint8_t *const *, const uint64_t *, uint64_t, uint256_t *)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return sha3_avx512;
+    if (__builtin_cpu_supports("avx2")) return sha3_avx2;
+    return sha3_scalar;
+}
+static void (*const sha3_multi)(const uint8_t *const *, const uint64_t *, uint64_t, uint256_t *) = sha3_select();
 #else
-static uint256_t sha3(const uint8_t *buffer, uint64_t size)
+static void (*const sha3_multi)(const uint8_t *const *, const uint64_t *, uint64_t, uint256_t *) = sha3_scalar;
+#endif
+// hashes count messages at once, results[i] = sha3(messages[i], sizes[i])
+static void sha3(const uint8_t *const *messages, const uint64_t *sizes, uint64_t count, uint256_t *results)
 {
-    local<uint8_t> output_l(64); uint8_t *output = output_l.data;
-    sha3(buffer, size, false, 1088, 0x01, output);
-    return uint256_t::from(output);
+    sha3_multi(messages, sizes, count, results);
 }
 #endif // NATIVE_CRYPTO
 
@@ -1728,97 +1950,171 @@ static inline void w2b32be(uint32_t w, uint8_t *b)
     b[1] = (uint8_t)(w >> 16);
     b[0] = (uint8_t)(w >> 24);
 }
-static void sha256(const uint8_t *message, uint64_t size, bool compressed, uint8_t *output)
-{
-    if (!compressed) {
-        uint64_t bitsize = 8 * size;
-        uint64_t modulo = (size + 1 + 8) % 64;
-        uint64_t padding = modulo > 0 ? 64 - modulo : 0;
-        uint64_t b_len = size + 1 + padding + 8;
-        local<uint8_t> b_l(b_len); uint8_t *b = b_l.data;
-        for (uint64_t i = 0; i < size; i++) b[i] = message[i];
-        for (uint64_t i = size; i < b_len; i++) b[i] = 0;
-        b[size] = 0x80;
-        w2b32be(bitsize >> 32, &b[b_len-8]);
-        w2b32be(bitsize, &b[b_len-4]);
-        sha256(b, b_len, true, output);
-        return;
-    }
-    static const uint32_t S[8] = {
-        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
-        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+static const uint32_t sha256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
     };
-    static const uint32_t K[64] = {
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
-    };
-    uint32_t s0 = S[0];
-    uint32_t s1 = S[1];
-    uint32_t s2 = S[2];
-    uint32_t s3 = S[3];
-    uint32_t s4 = S[4];
-    uint32_t s5 = S[5];
-    uint32_t s6 = S[6];
-    uint32_t s7 = S[7];
-    for (uint32_t j = 0; j < size/4; j += 16) {
+static const uint32_t sha256_S[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+// the 64 rounds over one block given its message schedule already added
+// to the round constants, words being STRIDE apart
+template<int STRIDE>
+__attribute__((always_inline)) static inline void sha256_rounds(uint32_t *s, const uint32_t *wk)
+{
+    uint32_t a = s[0];
+    uint32_t b = s[1];
+    uint32_t c = s[2];
+    uint32_t d = s[3];
+    uint32_t e = s[4];
+    uint32_t f = s[5];
+    uint32_t g = s[6];
+    uint32_t h = s[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + ep1(e) + ch(e, f, g) + wk[i * STRIDE];
+        uint32_t t2 = ep0(a) + maj(a, b, c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    s[0] += a;
+    s[1] += b;
+    s[2] += c;
+    s[3] += d;
+    s[4] += e;
+    s[5] += f;
+    s[6] += g;
+    s[7] += h;
+}
+// compresses count consecutive 64-byte blocks into the state s
+static void sha256_generic(uint32_t *s, const uint8_t *blocks, uint64_t count)
+{
+    for (uint64_t j = 0; j < count; j++, blocks += 64) {
         uint32_t w[64];
         for (int i = 0; i < 16; i++) {
-            w[i] = b2w32be(&message[4*(j+i)]);
+            w[i] = b2w32be(&blocks[4*i]);
         }
         for (int i = 16; i < 64; i++) {
             w[i] = w[i-16] + sig0(w[i-15]) + w[i-7] + sig1(w[i-2]);
         }
-        uint32_t a = s0;
-        uint32_t b = s1;
-        uint32_t c = s2;
-        uint32_t d = s3;
-        uint32_t e = s4;
-        uint32_t f = s5;
-        uint32_t g = s6;
-        uint32_t h = s7;
-        for (int i = 0; i < 64; i++) {
-            uint32_t t1 = h + ep1(e) + ch(e, f, g) + K[i] + w[i];
-            uint32_t t2 = ep0(a) + maj(a, b, c);
-            h = g;
-            g = f;
-            f = e;
-            e = d + t1;
-            d = c;
-            c = b;
-            b = a;
-            a = t1 + t2;
-        }
-        s0 += a;
-        s1 += b;
-        s2 += c;
-        s3 += d;
-        s4 += e;
-        s5 += f;
-        s6 += g;
-        s7 += h;
-    }
-    w2b32be(s0, &output[0]);
-    w2b32be(s1, &output[4]);
-    w2b32be(s2, &output[8]);
-    w2b32be(s3, &output[12]);
-    w2b32be(s4, &output[16]);
-    w2b32be(s5, &output[20]);
-    w2b32be(s6, &output[24]);
-    w2b32be(s7, &output[28]);
+        for (int i = 0; i < 64; i++) w[i] += sha256_K[i];
+        sha256_rounds<1>(s, w);
+    }
+}
+#if !defined(NATIVE_CRYPTO) && defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+// with the sha extensions the state is kept as the ABEF and CDGH halves
+// and each instruction performs two rounds
+__attribute__((target("sha,sse4.1"))) static void sha256_shani(uint32_t *s, const uint8_t *blocks, uint64_t count)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bL, 0x0405060700010203L);
+    __m128i t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&s[0]), 0xb1);
+    __m128i s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&s[4]), 0x1b);
+    __m128i s0 = _mm_alignr_epi8(t, s1, 8);
+    s1 = _mm_blend_epi16(s1, t, 0xf0);
+    for (uint64_t j = 0; j < count; j++, blocks += 64) {
+        __m128i abef = s0, cdgh = s1;
+        __m128i m[4];
+        for (int i = 0; i < 4; i++) m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[16 * i]), MASK);
+        for (int i = 0; i < 16; i++) {
+            if (i >= 4) {
+                __m128i x = _mm_sha256msg1_epu32(m[i % 4], m[(i + 1) % 4]);
+                x = _mm_add_epi32(x, _mm_alignr_epi8(m[(i + 3) % 4], m[(i + 2) % 4], 4));
+                m[i % 4] = _mm_sha256msg2_epu32(x, m[(i + 3) % 4]);
+            }
+            __m128i wk = _mm_add_epi32(m[i % 4], _mm_loadu_si128((const __m128i*)&sha256_K[4 * i]));
+            s1 = _mm_sha256rnds2_epu32(s1, s0, wk);
+            s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(wk, 0x0e));
+        }
+        s0 = _mm_add_epi32(s0, abef);
+        s1 = _mm_add_epi32(s1, cdgh);
+    }
+    t = _mm_shuffle_epi32(s0, 0x1b);
+    s1 = _mm_shuffle_epi32(s1, 0xb1);
+    _mm_storeu_si128((__m128i*)&s[0], _mm_blend_epi16(t, s1, 0xf0));
+    _mm_storeu_si128((__m128i*)&s[4], _mm_alignr_epi8(s1, t, 8));
+}
+// with avx2 the message schedules of up to eight blocks are expanded at
+// once, one block per vector element, leaving only the rounds sequential
+// a lone block is not worth the transposition and takes the scalar path
+typedef uint32_t sha256_v8 __attribute__((vector_size(32)));
+__attribute__((target("avx2,bmi2"))) static void sha256_avx2(uint32_t *s, const uint8_t *blocks, uint64_t count)
+{
+    while (count > 0) {
+        if (count == 1) { sha256_generic(s, blocks, 1); return; }
+        uint64_t n = count < 8 ? count : 8;
+        sha256_v8 w[64];
+        for (int i = 0; i < 16; i++) {
+            for (uint64_t k = 0; k < 8; k++) w[i][k] = k < n ? b2w32be(&blocks[64 * k + 4 * i]) : 0;
+        }
+        for (int i = 16; i < 64; i++) {
+            sha256_v8 x = w[i-15], y = w[i-2];
+            w[i] = w[i-16] + w[i-7]
+                + (((x >> 7) | (x << 25)) ^ ((x >> 18) | (x << 14)) ^ (x >> 3))
+                + (((y >> 17) | (y << 15)) ^ ((y >> 19) | (y << 13)) ^ (y >> 10));
+        }
+        for (int i = 0; i < 64; i++) w[i] += sha256_K[i];
+        for (uint64_t k = 0; k < n; k++) sha256_rounds<8>(s, &w[0][k]);
+        blocks += 64 * n;
+        count -= n;
+    }
+}
+// the sha extensions are looked up with cpuid directly as not every
+// compiler knows them by name
+static void (*sha256_select())(uint32_t *, const uint8_t *, uint64_t)
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA) > 0) {
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1) > 0) return sha256_shani;
+    }
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) return sha256_avx2;
+    return sha256_generic;
+}
+static void (*const sha256_compress)(uint32_t *, const uint8_t *, uint64_t) = sha256_select();
+#else
+static void (*const sha256_compress)(uint32_t *, const uint8_t *, uint64_t) = sha256_generic;
+#endif
+// full blocks are compressed straight from the message, only the tail
+// is copied to be padded
+static void sha256(const uint8_t *message, uint64_t size, bool compressed, uint8_t *output)
+{
+    uint32_t s[8];
+    for (int i = 0; i < 8; i++) s[i] = sha256_S[i];
+    uint64_t count = size / 64;
+    sha256_compress(s, message, count);
+    if (!compressed) {
+        uint64_t bitsize = 8 * size;
+        uint64_t tail = size - 64 * count;
+        uint64_t b_len = tail + 1 + 8 > 64 ? 128 : 64;
+        uint8_t b[128];
+        for (uint64_t i = 0; i < tail; i++) b[i] = message[64 * count + i];
+        for (uint64_t i = tail; i < b_len; i++) b[i] = 0;
+        b[tail] = 0x80;
+        w2b32be(bitsize >> 32, &b[b_len-8]);
+        w2b32be(bitsize, &b[b_len-4]);
+        sha256_compress(s, b, b_len / 64);
+    }
+    for (int i = 0; i < 8; i++) w2b32be(s[i], &output[4 * i]);
 }
 #ifdef NATIVE_CRYPTO
 static uint256_t sha256(const uint8_t *buffer, uint64_t size);
@@ -1989,36 +2285,35 @@ static void blake2f(const uint32_t ROUNDS,
     uint64_t &h4, uint64_t &h5, uint64_t &h6, uint64_t &h7,
     uint64_t w[16], uint64_t t0, uint64_t t1, bool last_chunk);
 #else
-static void blake2f(const uint32_t ROUNDS,
-    uint64_t &h0, uint64_t &h1, uint64_t &h2, uint64_t &h3,
-    uint64_t &h4, uint64_t &h5, uint64_t &h6, uint64_t &h7,
-    uint64_t w[16], uint64_t t0, uint64_t t1, bool last_chunk)
+static const uint8_t blake2_SIGMA[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+};
+static const uint64_t blake2_IV[8] = {
+    0x6a09e667f3bcc908, 0xbb67ae8584caa73b,
+    0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+    0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+    0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+};
+// compresses a block w into the state h
+static void blake2f_generic(uint32_t rounds, uint64_t *h, const uint64_t *w, uint64_t t0, uint64_t t1, bool last_chunk)
 {
-    static const uint8_t SIGMA[10][16] = {
-        {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
-        { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
-        { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
-        {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
-        {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
-        {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
-        { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
-        { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
-        {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
-        { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
-    };
-    static const uint64_t iv[8] = {
-        0x6a09e667f3bcc908, 0xbb67ae8584caa73b,
-        0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
-        0x510e527fade682d1, 0x9b05688c2b3e6c1f,
-        0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
-    };
-    uint64_t v0 = h0,  v1 = h1, v2 = h2, v3 = h3, v4 = h4, v5 = h5, v6 = h6, v7 = h7;
-    uint64_t v8 = iv[0], v9 = iv[1], v10 = iv[2], v11 = iv[3], v12 = iv[4], v13 = iv[5], v14 = iv[6], v15 = iv[7];
+    uint64_t v0 = h[0], v1 = h[1], v2 = h[2], v3 = h[3], v4 = h[4], v5 = h[5], v6 = h[6], v7 = h[7];
+    uint64_t v8 = blake2_IV[0], v9 = blake2_IV[1], v10 = blake2_IV[2], v11 = blake2_IV[3];
+    uint64_t v12 = blake2_IV[4], v13 = blake2_IV[5], v14 = blake2_IV[6], v15 = blake2_IV[7];
     v12 ^= t0;
     v13 ^= t1;
     if (last_chunk) v14 ^= 0xffffffffffffffffL;
-    for (uint32_t r = 0; r < ROUNDS; r++) {
-        const uint8_t *indexes = SIGMA[r % 10];
+    for (uint32_t r = 0; r < rounds; r++) {
+        const uint8_t *indexes = blake2_SIGMA[r % 10];
         uint64_t m[16];
         for (int i = 0; i < 16; i++) m[i] = w[indexes[i]];
         uint64_t _v0, _v1, _v2, _v3, _v4, _v5, _v6, _v7;
@@ -2034,23 +2329,236 @@ static void blake2f(const uint32_t ROUNDS,
         v0 = _v0; v1 = _v1; v2 = _v2; v3 = _v3; v4 = _v4; v5 = _v5; v6 = _v6; v7 = _v7;
         v8 = _v8; v9 = _v9; v10 = _v10; v11 = _v11; v12 = _v12; v13 = _v13; v14 = _v14; v15 = _v15;
     }
-    h0 ^= v0 ^ v8;
-    h1 ^= v1 ^ v9;
-    h2 ^= v2 ^ v10;
-    h3 ^= v3 ^ v11;
-    h4 ^= v4 ^ v12;
-    h5 ^= v5 ^ v13;
-    h6 ^= v6 ^ v14;
-    h7 ^= v7 ^ v15;
+    h[0] ^= v0 ^ v8;
+    h[1] ^= v1 ^ v9;
+    h[2] ^= v2 ^ v10;
+    h[3] ^= v3 ^ v11;
+    h[4] ^= v4 ^ v12;
+    h[5] ^= v5 ^ v13;
+    h[6] ^= v6 ^ v14;
+    h[7] ^= v7 ^ v15;
+}
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+// the vector variants keep the state as rows, v0-v3, v4-v7, v8-v11 and
+// v12-v15, so that each mix step runs over the four columns at once and
+// the diagonal steps rotate the rows into place before and after
+// rotations by 32, 24 and 16 are byte shuffles, by 63 a shift and an add
+// the standard 12 rounds are unrolled so that the message indexes are
+// constants, any other count loops over the rounds
+__attribute__((target("sse4.1"), always_inline))
+static inline void blake2f_sse_g(__m128i &a, __m128i &b, __m128i &c, __m128i &d, const __m128i &x, const __m128i &y)
+{
+    const __m128i R24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m128i R16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    a = _mm_add_epi64(_mm_add_epi64(a, b), x);
+    d = _mm_shuffle_epi32(_mm_xor_si128(d, a), 0xb1);
+    c = _mm_add_epi64(c, d);
+    b = _mm_shuffle_epi8(_mm_xor_si128(b, c), R24);
+    a = _mm_add_epi64(_mm_add_epi64(a, b), y);
+    d = _mm_shuffle_epi8(_mm_xor_si128(d, a), R16);
+    c = _mm_add_epi64(c, d);
+    b = _mm_xor_si128(b, c);
+    b = _mm_xor_si128(_mm_srli_epi64(b, 63), _mm_add_epi64(b, b));
+}
+// rows are split in low and high halves of two lanes each
+__attribute__((target("sse4.1"), always_inline))
+static inline void blake2f_sse_round(__m128i *v, const uint64_t *w, const uint8_t *s)
+{
+    __m128i &al = v[0], &ah = v[1], &bl = v[2], &bh = v[3];
+    __m128i &cl = v[4], &ch = v[5], &dl = v[6], &dh = v[7];
+    blake2f_sse_g(al, bl, cl, dl, _mm_set_epi64x(w[s[2]], w[s[0]]), _mm_set_epi64x(w[s[3]], w[s[1]]));
+    blake2f_sse_g(ah, bh, ch, dh, _mm_set_epi64x(w[s[6]], w[s[4]]), _mm_set_epi64x(w[s[7]], w[s[5]]));
+    __m128i t0 = _mm_alignr_epi8(bh, bl, 8), t1 = _mm_alignr_epi8(bl, bh, 8);
+    bl = t0; bh = t1;
+    t0 = cl; cl = ch; ch = t0;
+    t0 = _mm_alignr_epi8(dh, dl, 8); t1 = _mm_alignr_epi8(dl, dh, 8);
+    dl = t1; dh = t0;
+    blake2f_sse_g(al, bl, cl, dl, _mm_set_epi64x(w[s[10]], w[s[8]]), _mm_set_epi64x(w[s[11]], w[s[9]]));
+    blake2f_sse_g(ah, bh, ch, dh, _mm_set_epi64x(w[s[14]], w[s[12]]), _mm_set_epi64x(w[s[15]], w[s[13]]));
+    t0 = _mm_alignr_epi8(bl, bh, 8); t1 = _mm_alignr_epi8(bh, bl, 8);
+    bl = t0; bh = t1;
+    t0 = cl; cl = ch; ch = t0;
+    t0 = _mm_alignr_epi8(dl, dh, 8); t1 = _mm_alignr_epi8(dh, dl, 8);
+    dl = t1; dh = t0;
+}
+__attribute__((target("sse4.1")))
+static void blake2f_sse(uint32_t rounds, uint64_t *h, const uint64_t *w, uint64_t t0, uint64_t t1, bool last_chunk)
+{
+    __m128i v[8];
+    for (int i = 0; i < 4; i++) v[i] = _mm_loadu_si128((const __m128i*)&h[2 * i]);
+    for (int i = 0; i < 4; i++) v[4 + i] = _mm_loadu_si128((const __m128i*)&blake2_IV[2 * i]);
+    v[6] = _mm_xor_si128(v[6], _mm_set_epi64x(t1, t0));
+    v[7] = _mm_xor_si128(v[7], _mm_set_epi64x(0, last_chunk ? 0xffffffffffffffffL : 0));
+    if (rounds == 12) {
+        blake2f_sse_round(v, w, blake2_SIGMA[0]);
+        blake2f_sse_round(v, w, blake2_SIGMA[1]);
+        blake2f_sse_round(v, w, blake2_SIGMA[2]);
+        blake2f_sse_round(v, w, blake2_SIGMA[3]);
+        blake2f_sse_round(v, w, blake2_SIGMA[4]);
+        blake2f_sse_round(v, w, blake2_SIGMA[5]);
+        blake2f_sse_round(v, w, blake2_SIGMA[6]);
+        blake2f_sse_round(v, w, blake2_SIGMA[7]);
+        blake2f_sse_round(v, w, blake2_SIGMA[8]);
+        blake2f_sse_round(v, w, blake2_SIGMA[9]);
+        blake2f_sse_round(v, w, blake2_SIGMA[0]);
+        blake2f_sse_round(v, w, blake2_SIGMA[1]);
+    } else {
+        for (uint32_t r = 0; r < rounds; r++) blake2f_sse_round(v, w, blake2_SIGMA[r % 10]);
+    }
+    for (int i = 0; i < 4; i++) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&h[2 * i]), _mm_xor_si128(v[i], v[4 + i]));
+        _mm_storeu_si128((__m128i*)&h[2 * i], x);
+    }
+}
+__attribute__((target("avx2"), always_inline))
+static inline void blake2f_avx2_g(__m256i &a, __m256i &b, __m256i &c, __m256i &d, const __m256i &x, const __m256i &y)
+{
+    const __m256i R24 = _mm256_setr_epi8(
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m256i R16 = _mm256_setr_epi8(
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    a = _mm256_add_epi64(_mm256_add_epi64(a, b), x);
+    d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), 0xb1);
+    c = _mm256_add_epi64(c, d);
+    b = _mm256_shuffle_epi8(_mm256_xor_si256(b, c), R24);
+    a = _mm256_add_epi64(_mm256_add_epi64(a, b), y);
+    d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), R16);
+    c = _mm256_add_epi64(c, d);
+    b = _mm256_xor_si256(b, c);
+    b = _mm256_xor_si256(_mm256_srli_epi64(b, 63), _mm256_add_epi64(b, b));
+}
+// rows fit one register each and are rotated with lane permutes
+__attribute__((target("avx2"), always_inline))
+static inline void blake2f_avx2_round(__m256i *v, const uint64_t *w, const uint8_t *s)
+{
+    __m256i &a = v[0], &b = v[1], &c = v[2], &d = v[3];
+    blake2f_avx2_g(a, b, c, d,
+        _mm256_set_epi64x(w[s[6]], w[s[4]], w[s[2]], w[s[0]]),
+        _mm256_set_epi64x(w[s[7]], w[s[5]], w[s[3]], w[s[1]]));
+    b = _mm256_permute4x64_epi64(b, 0x39);
+    c = _mm256_permute4x64_epi64(c, 0x4e);
+    d = _mm256_permute4x64_epi64(d, 0x93);
+    blake2f_avx2_g(a, b, c, d,
+        _mm256_set_epi64x(w[s[14]], w[s[12]], w[s[10]], w[s[8]]),
+        _mm256_set_epi64x(w[s[15]], w[s[13]], w[s[11]], w[s[9]]));
+    b = _mm256_permute4x64_epi64(b, 0x93);
+    c = _mm256_permute4x64_epi64(c, 0x4e);
+    d = _mm256_permute4x64_epi64(d, 0x39);
+}
+__attribute__((target("avx2")))
+static void blake2f_avx2(uint32_t rounds, uint64_t *h, const uint64_t *w, uint64_t t0, uint64_t t1, bool last_chunk)
+{
+    __m256i v[4];
+    v[0] = _mm256_loadu_si256((const __m256i*)&h[0]);
+    v[1] = _mm256_loadu_si256((const __m256i*)&h[4]);
+    v[2] = _mm256_loadu_si256((const __m256i*)&blake2_IV[0]);
+    v[3] = _mm256_loadu_si256((const __m256i*)&blake2_IV[4]);
+    v[3] = _mm256_xor_si256(v[3], _mm256_set_epi64x(0, last_chunk ? 0xffffffffffffffffL : 0, t1, t0));
+    if (rounds == 12) {
+        blake2f_avx2_round(v, w, blake2_SIGMA[0]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[1]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[2]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[3]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[4]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[5]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[6]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[7]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[8]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[9]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[0]);
+        blake2f_avx2_round(v, w, blake2_SIGMA[1]);
+    } else {
+        for (uint32_t r = 0; r < rounds; r++) blake2f_avx2_round(v, w, blake2_SIGMA[r % 10]);
+    }
+    __m256i lo = _mm256_xor_si256(v[0], v[2]), hi = _mm256_xor_si256(v[1], v[3]);
+    _mm256_storeu_si256((__m256i*)&h[0], _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&h[0]), lo));
+    _mm256_storeu_si256((__m256i*)&h[4], _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&h[4]), hi));
+}
+static void (*blake2f_select())(uint32_t, uint64_t *, const uint64_t *, uint64_t, uint64_t, bool)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return blake2f_avx2;
+    if (__builtin_cpu_supports("sse4.1")) return blake2f_sse;
+    return blake2f_generic;
+}
+static void (*const blake2f_compress)(uint32_t, uint64_t *, const uint64_t *, uint64_t, uint64_t, bool) = blake2f_select();
+#else
+static void (*const blake2f_compress)(uint32_t, uint64_t *, const uint64_t *, uint64_t, uint64_t, bool) = blake2f_generic;
+#endif
+static void blake2f(const uint32_t ROUNDS,
+    uint64_t &h0, uint64_t &h1, uint64_t &h2, uint64_t &h3,
+    uint64_t &h4, uint64_t &h5, uint64_t &h6, uint64_t &h7,
+    uint64_t w[16], uint64_t t0, uint64_t t1, bool last_chunk)
+{
+    uint64_t h[8] = { h0, h1, h2, h3, h4, h5, h6, h7 };
+    blake2f_compress(ROUNDS, h, w, t0, t1, last_chunk);
+    h0 = h[0]; h1 = h[1]; h2 = h[2]; h3 = h[3];
+    h4 = h[4]; h5 = h[5]; h6 = h[6]; h7 = h[7];
 }
 #endif // NATIVE_CRYPTO
 
 // ** elliptic curves **
 
+// bigint constants are read through accessors named after them, taking
+// a table of 32-bit words, or a pair of 8-word tables for double coordinates
+// the standalone build constructs them at startup so that the accessors
+// return a plain reference, the contract builds them on first use instead,
+// as its static initialization runs on every action
+#ifdef NATIVE_CRYPTO
+#define _bigconst(name, words, size) \
+    static const bigint &name() { static const bigint v(words, size); return v; }
+#define _bigpair(name, words) \
+    static const bigint *name() { static const bigint v[2] = { bigint(words[0], 8), bigint(words[1], 8) }; return v; }
+#else
+#define _bigconst(name, words, size) \
+    static const bigint name##_value(words, size); \
+    static inline const bigint &name() { return name##_value; }
+#define _bigpair(name, words) \
+    static const bigint name##_value[2] = { bigint(words[0], 8), bigint(words[1], 8) }; \
+    static inline const bigint *name() { return name##_value; }
+#endif // NATIVE_CRYPTO
+
+// bn256 constants inlined in the tower field and twist arithmetic below
+// given as tables of 32-bit words (little endian), nothing is parsed at startup
+// pairs hold the x and y halves of a double coordinate
+static const uint32_t xi_2_p_2_3_[2][8] = {
+    { 0xcd2b8126, 0xc13b4711, 0x1bdec763, 0x3685d2ea, 0x3b0b1c92, 0x9f3a80b0, 0xe7fd8aee, 0x2c145edb },
+    { 0x921ea762, 0x848a1f55, 0xbe94ec72, 0xd33365f7, 0x5a181e84, 0x80f3c0b7, 0x64eea801, 0x05b54f5e },
+};
+static const uint32_t xi_p_1_3_[2][8] = {
+    { 0x640fcba2, 0x1665d51c, 0x0b7c9dce, 0x32ae2a1d, 0xd75a0794, 0x4ba4cc8b, 0x61ebae20, 0x16c9e550 },
+    { 0x176f553d, 0x99e39557, 0xc2c3330c, 0xb78cc310, 0xf559b143, 0x4c0bec3c, 0x4f7911f7, 0x2fb34798 },
+};
+static const uint32_t xi_p_1_6_[2][8] = {
+    { 0x80f362ac, 0xca5cf05f, 0x8eeec7e5, 0x74799277, 0x12150b8e, 0xa6327cfe, 0xb4fae7e6, 0x246996f3 },
+    { 0xdcc9e470, 0xd60b35da, 0x292f2176, 0x5c521e08, 0x76e68b60, 0xe8b99fdd, 0x2865a7df, 0x1284b71c },
+};
+static const uint32_t xi_p_1_2_[2][8] = {
+    { 0x2623b0e3, 0x82d37f63, 0x8fa25bd2, 0x21807dc9, 0xec796f2b, 0x0704b5a7, 0xac41049a, 0x07c03cbc },
+    { 0x71a0135a, 0xdc540146, 0xa9c95998, 0xdbaae0ed, 0xb6e2f9b9, 0xdc5ec698, 0x489af5dc, 0x063cf305 },
+};
+static const uint32_t twist_b_[2][8] = {
+    { 0x85c315d2, 0xe4a2bd06, 0xe52d1852, 0xa74fa084, 0xeed8fdf4, 0xcd2cafad, 0x3af0fed4, 0x009713b0 },
+    { 0x24a138e5, 0x3267e6dc, 0x59dbefa3, 0xb5b4c5e5, 0x1be06ac3, 0x81be1899, 0xceb8aaae, 0x2b149d40 },
+};
+static const uint32_t xi_2_p2_2_3_[8] = { 0x77fffffe, 0x57634731, 0xacdb5c4f, 0xd4f263f1, 0xa0d48bac, 0x59e26bce, 0x00000000, 0x00000000 };
+static const uint32_t xi_p2_1_3_[8] = { 0x607cfd48, 0xe4bd44e5, 0xbb966e3d, 0xc28f069f, 0xe0acccb0, 0x5e6dd9e7, 0xe131a029, 0x30644e72 };
+static const uint32_t xi_p2_1_6_[8] = { 0x607cfd49, 0xe4bd44e5, 0xbb966e3d, 0xc28f069f, 0xe0acccb0, 0x5e6dd9e7, 0xe131a029, 0x30644e72 };
+_bigpair(XI_2_P_2_3, xi_2_p_2_3_)
+_bigpair(XI_P_1_3, xi_p_1_3_)
+_bigpair(XI_P_1_6, xi_p_1_6_)
+_bigpair(XI_P_1_2, xi_p_1_2_)
+_bigpair(TWIST_B, twist_b_)
+_bigconst(XI_2_P2_2_3, xi_2_p2_2_3_, 8)
+_bigconst(XI_P2_1_3, xi_p2_1_3_, 8)
+_bigconst(XI_P2_1_6, xi_p2_1_6_, 8)
+
 // a double coordinate
 // implemented as a template to allow instantiation with different field parameters
 // required by this implemenation only to perform bn256 pairing
-template<const char *_P>
+template<const bigint &(*_P)()>
 struct Gen2_t {
     using Gen2 = Gen2_t;
     bigint x, y;
@@ -2081,7 +2589,7 @@ struct Gen2_t {
     friend const Gen2 operator*(const Gen2& v1, const Gen2& v2) { return Gen2(v1) *= v2; }
     friend const Gen2 operator*(const Gen2& v1, const bigint& v2) { return Gen2(v1) *= v2; }
     static bigint neg(const bigint &v) { return P() - (v % P()); }
-    static bigint P() { static bigint P = big(_P); return P; }
+    static const bigint &P() { return _P(); }
 };
 
 // a triple of double coordinates
@@ -2098,21 +2606,9 @@ struct Gen6_t {
     bool is_one() const { return x.is_zero() && y.is_zero() && z.is_one(); }
     Gen6 twice() const { return Gen6(x.twice(), y.twice(), z.twice()); }
     Gen6 frob() const {
-        static const Gen2 XI_2_P_2_3(
-            big("19937756971775647987995932169929341994314640652964949448313374472400716661030"),
-            big("2581911344467009335267311115468803099551665605076196740867805258568234346338")
-        );
-        static const Gen2 XI_P_1_3(
-            big("10307601595873709700152284273816112264069230130616436755625194854815875713954"),
-            big("21575463638280843010398324269430826099269044274347216827212613867836435027261")
-        );
-        return Gen6(x.conj() * XI_2_P_2_3, y.conj() * XI_P_1_3, z.conj());
-    }
-    Gen6 frob2() const {
-        static const bigint XI_2_P2_2_3 = big("2203960485148121921418603742825762020974279258880205651966");
-        static const bigint XI_P2_1_3 = big("21888242871839275220042445260109153167277707414472061641714758635765020556616");
-        return Gen6(x * XI_2_P2_2_3, y * XI_P2_1_3, z);
+        return Gen6(x.conj() * Gen2(XI_2_P_2_3()[0], XI_2_P_2_3()[1]), y.conj() * Gen2(XI_P_1_3()[0], XI_P_1_3()[1]), z.conj());
     }
+    Gen6 frob2() const { return Gen6(x * XI_2_P2_2_3(), y * XI_P2_1_3(), z); }
     Gen6 inv() const {
         Gen2 t0 = x.sqr().mulxi() - (y * z);
         Gen2 t1 = y.sqr() - (x * z);
@@ -2174,23 +2670,47 @@ struct Gen12_t {
         }
         return sum;
     }
-    Gen12 frob() const {
-        static const Gen2 XI_P_1_6(
-            big("16469823323077808223889137241176536799009286646108169935659301613961712198316"),
-            big("8376118865763821496583973867626364092589906065868298776909617916018768340080")
-        );
-        return Gen12(x.frob() * XI_P_1_6, y.frob());
-    }
-    Gen12 frob2() const {
-        static const bigint XI_P2_1_6 = big("21888242871839275220042445260109153167277707414472061641714758635765020556617");
-        return Gen12(x.frob2() * XI_P2_1_6, y.frob2());
-    }
+    Gen12 frob() const { return Gen12(x.frob() * Gen2(XI_P_1_6()[0], XI_P_1_6()[1]), y.frob()); }
+    Gen12 frob2() const { return Gen12(x.frob2() * XI_P2_1_6(), y.frob2()); }
     Gen12 inv() const { return Gen12(-x, y) * (y.sqr() - x.sqr().multau()).inv(); }
     Gen12 sqr() const {
         Gen6 t0 = x * y;
         Gen6 t1 = (x + y) * (x.multau() + y) - (t0 + t0.multau());
         return Gen12(t0.twice(), t1);
     }
+    // granger-scott squaring, only valid within the cyclotomic subgroup
+    // which is where the hard part of the final exponentiation operates
+    Gen12 cyclo_sqr() const {
+        Gen2 t0 = x.y.sqr();
+        Gen2 t1 = y.z.sqr();
+        Gen2 t2 = y.x.sqr();
+        Gen2 t3 = x.z.sqr();
+        Gen2 t4 = x.x.sqr();
+        Gen2 t5 = y.y.sqr();
+        Gen2 t6 = (x.y + y.z).sqr() - (t0 + t1);
+        Gen2 t7 = (y.x + x.z).sqr() - (t2 + t3);
+        Gen2 t8 = ((x.x + y.y).sqr() - (t4 + t5)).mulxi();
+        t0 = t0.mulxi() + t1;
+        t2 = t2.mulxi() + t3;
+        t4 = t4.mulxi() + t5;
+        return Gen12(
+            Gen6((t7 + x.x).twice() + t7, (t6 + x.y).twice() + t6, (t8 + x.z).twice() + t8),
+            Gen6((t4 - y.x).twice() + t4, (t2 - y.y).twice() + t2, (t0 - y.z).twice() + t0)
+        );
+    }
+    // exponentiation by a power given in non-adjacent form, most significant digit first
+    // negative digits are free as the inverse is the conjugate in the cyclotomic subgroup
+    Gen12 cyclo_pow(const int8_t *naf, uint64_t size) const {
+        const Gen12 &a = *this;
+        Gen12 c = a.conj();
+        Gen12 sum; sum = 1;
+        for (uint64_t i = 0; i < size; i++) {
+            if (i > 0) sum = sum.cyclo_sqr();
+            if (naf[i] > 0) sum *= a;
+            if (naf[i] < 0) sum *= c;
+        }
+        return sum;
+    }
     bool is_one() const { Gen12 t = canon(); return t.x.is_zero() && t.y.is_one(); }
     Gen12 canon() const { return Gen12(x.canon(), y.canon()); }
     Gen12& operator=(const bigint& v) { x = 0; y = v; return *this; }
@@ -2208,7 +2728,7 @@ struct Gen12_t {
 // a general elliptic curve point encoded as a jacobian
 // parameterized over the field prime P and the constant B
 // assumes A is always zero, which is the case of use in this implementation
-template<const char *_P, int _B>
+template<const bigint &(*_P)(), int _B>
 struct CurvePoint_t {
     using CurvePoint = CurvePoint_t;
     bigint x, y, z, t;
@@ -2290,14 +2810,14 @@ struct CurvePoint_t {
     friend const CurvePoint operator+(const CurvePoint& v1, const CurvePoint& v2) { return CurvePoint(v1) += v2; }
     friend const CurvePoint operator*(const CurvePoint& v1, const bigint& v2) { return CurvePoint(v1) *= v2; }
     static bigint neg(const bigint &v) { return P() - (v % P()); }
-    static bigint P() { static bigint P = big(_P); return P; }
+    static const bigint &P() { return _P(); }
 };
 
 // the dual twist point to the curve point
 // parameterized over the pair of coordinates and order Q
 // required by this implemenation only to perform bn256 pairing
 // not made completely general as some constants for bn256 are inlined
-template<class Gen2, const char *_Q>
+template<class Gen2, const bigint &(*_Q)()>
 struct TwistPoint_t {
     using TwistPoint = TwistPoint_t;
     Gen2 x, y, z, t;
@@ -2308,11 +2828,7 @@ struct TwistPoint_t {
     TwistPoint_t(const Gen2 &_x, const Gen2 &_y, const Gen2 &_z, const Gen2 &_t) : x(_x), y(_y), z(_z), t(_t) {}
     bool is_inf() const { return z.is_zero(); }
     bool is_valid() const {
-        static const Gen2 twistB(
-            big("266929791119991161246907387137283842545076965332900288569378510910307636690"),
-            big("19485874751759354771024239261021720505790618469301721065564631296452457478373")
-        );
-        Gen2 t = y.sqr() - (x.sqr() * x + twistB);
+        Gen2 t = y.sqr() - (x.sqr() * x + Gen2(TWIST_B()[0], TWIST_B()[1]));
         t = t.canon();
         if (t.x != 0 || t.y != 0) return false;
         TwistPoint p = *this * Q();
@@ -2383,54 +2899,711 @@ struct TwistPoint_t {
     }
     friend const TwistPoint operator+(const TwistPoint& v1, const TwistPoint& v2) { return TwistPoint(v1) += v2; }
     friend const TwistPoint operator*(const TwistPoint& v1, const bigint& v2) { return TwistPoint(v1) *= v2; }
-    static bigint Q() { static bigint Q = big(_Q); return Q; }
+    static const bigint &Q() { return _Q(); }
 };
 
+// width-w non-adjacent form recoding of a scalar, least significant digit first
+// all non-zero digits are odd and bounded by 2^(w-1) in absolute value
+static uint64_t wnaf(const bigint &scalar, int w, int8_t *naf, uint64_t size)
+{
+    bigint k = scalar;
+    uint64_t count = 0;
+    while (k > 0) {
+        assert(count < size);
+        int d = 0;
+        if (k.bit(0)) {
+            for (int j = 0; j < w; j++) d |= k.bit(j) << j;
+            if (d >= (1 << (w - 1))) d -= 1 << w;
+            if (d > 0) k -= bigint(d); else k += bigint(-d);
+        }
+        naf[count++] = d;
+        k >>= 1;
+    }
+    return count;
+}
+
 // ** secp256k1 **
 
 // seckp256k1 constants
-static const char p_[] = "115792089237316195423570985008687907853269984665640564039457584007908834671663";
-static const char q_[] = "115792089237316195423570985008687907852837564279074904382605163141518161494337";
+static const uint32_t p_w_[8] = { 0xfffffc2f, 0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+_bigconst(p_, p_w_, 8)
 
 // seckp256k1 curve definition
 using G0 = CurvePoint_t<p_, 7>;
 
 #ifdef NATIVE_CRYPTO
 static G0 ecrecover(const uint256_t &_h, const uint256_t &_v, const uint256_t &_r, const uint256_t &_s);
+static void ecrecover(const uint256_t *_h, const uint256_t *_v, const uint256_t *_r, const uint256_t *_s, uint64_t count, G0 *points)
+{
+    for (uint64_t i = 0; i < count; i++) points[i] = ecrecover(_h[i], _v[i], _r[i], _s[i]);
+}
 #else
+// fixed width 256-bit modular arithmetic for a modulus m close to 2^256
+// products are reduced by folding the upper half times c = 2^256 - m, which is
+// short for both secp256k1 moduli, instead of dividing as bigint does
+// values are kept as 8 little endian 32-bit words, always fully reduced
+template<const uint32_t *_M, const uint32_t *_C, int _CW>
+struct Mod256_t {
+    using Mod256 = Mod256_t;
+    uint32_t w[8];
+    static Mod256 of(uint32_t v) { Mod256 t = {{v, 0, 0, 0, 0, 0, 0, 0}}; return t; }
+    static Mod256 from(const uint8_t *buffer) {
+        Mod256 t;
+        for (int i = 0; i < 8; i++) t.w[i] = b2w32be(&buffer[4 * (7 - i)]);
+        t.reduce(0);
+        return t;
+    }
+    static void to(const Mod256 &v, uint8_t *buffer) {
+        for (int i = 0; i < 8; i++) w2b32be(v.w[i], &buffer[4 * (7 - i)]);
+    }
+    static int cmp(const uint32_t *a, const uint32_t *b) {
+        for (int i = 8; i > 0; i--) {
+            if (a[i-1] < b[i-1]) return -1;
+            if (a[i-1] > b[i-1]) return 1;
+        }
+        return 0;
+    }
+    // full 512-bit product
+    static void mul(const uint32_t *a, const uint32_t *b, uint32_t *t) {
+        for (int i = 0; i < 16; i++) t[i] = 0;
+        for (int i = 0; i < 8; i++) {
+            uint64_t carry = 0;
+            for (int j = 0; j < 8; j++) {
+                uint64_t x = (uint64_t)a[i] * b[j] + t[i+j] + carry;
+                t[i+j] = (uint32_t)x;
+                carry = x >> 32;
+            }
+            t[i+8] = (uint32_t)carry;
+        }
+    }
+    // replaces h * 2^256 + l by l + h * c until the upper half vanishes
+    static void fold(uint32_t *t) {
+        for (;;) {
+            uint32_t h = 0;
+            for (int i = 8; i < 16; i++) h |= t[i];
+            if (h == 0) return;
+            uint32_t r[16];
+            for (int i = 0; i < 8; i++) { r[i] = t[i]; r[i+8] = 0; }
+            for (int i = 0; i < 8; i++) {
+                if (t[i+8] == 0) continue;
+                uint64_t carry = 0;
+                for (int j = 0; j < _CW; j++) {
+                    uint64_t x = (uint64_t)t[i+8] * _C[j] + r[i+j] + carry;
+                    r[i+j] = (uint32_t)x;
+                    carry = x >> 32;
+                }
+                for (int k = i + _CW; carry > 0; k++) {
+                    uint64_t x = (uint64_t)r[k] + carry;
+                    r[k] = (uint32_t)x;
+                    carry = x >> 32;
+                }
+            }
+            for (int i = 0; i < 16; i++) t[i] = r[i];
+        }
+    }
+    void reduce(uint32_t carry) {
+        while (carry > 0 || cmp(w, _M) >= 0) {
+            uint64_t borrow = 0;
+            for (int i = 0; i < 8; i++) {
+                uint64_t x = (uint64_t)w[i] - _M[i] - borrow;
+                w[i] = (uint32_t)x;
+                borrow = (x >> 32) & 1;
+            }
+            carry -= borrow;
+        }
+    }
+    bool is_zero() const { uint32_t t = 0; for (int i = 0; i < 8; i++) t |= w[i]; return t == 0; }
+    bool is_odd() const { return (w[0] & 1) > 0; }
+    // whether the value is above m/2, that is, its negation is smaller
+    bool is_high() const { Mod256 t = -*this; return cmp(t.w, w) < 0; }
+    Mod256 sqr() const { return *this * *this; }
+    Mod256 sqr(int n) const { Mod256 t = *this; for (int i = 0; i < n; i++) t = t.sqr(); return t; }
+    // fermat's little theorem using 4-bit windows
+    Mod256 inv() const {
+        Mod256 table[16];
+        table[0] = of(1);
+        for (int i = 1; i < 16; i++) table[i] = table[i-1] * *this;
+        Mod256 t = of(1);
+        for (int i = 64; i > 0; i--) {
+            uint32_t e = i - 1 < 8 ? _M[0] - 2 : _M[(i - 1) / 8];
+            t = t.sqr(4) * table[(e >> (4 * ((i - 1) % 8))) & 0xf];
+        }
+        return t;
+    }
+    // montgomery's trick, inverts many values at the cost of a single inversion
+    // zeros are left untouched
+    static void batch_inv(Mod256 *values, uint64_t size) {
+        std::vector<Mod256> acc(size);
+        Mod256 prod = of(1);
+        for (uint64_t i = 0; i < size; i++) {
+            acc[i] = prod;
+            if (!values[i].is_zero()) prod *= values[i];
+        }
+        Mod256 inv = prod.inv();
+        for (uint64_t i = size; i > 0; i--) {
+            if (values[i-1].is_zero()) continue;
+            Mod256 t = inv * acc[i-1];
+            inv *= values[i-1];
+            values[i-1] = t;
+        }
+    }
+    Mod256 operator-() const { return of(0) - *this; }
+    Mod256& operator+=(const Mod256& v) {
+        uint64_t carry = 0;
+        for (int i = 0; i < 8; i++) {
+            uint64_t x = (uint64_t)w[i] + v.w[i] + carry;
+            w[i] = (uint32_t)x;
+            carry = x >> 32;
+        }
+        reduce(carry);
+        return *this;
+    }
+    Mod256& operator-=(const Mod256& v) {
+        uint64_t borrow = 0;
+        for (int i = 0; i < 8; i++) {
+            uint64_t x = (uint64_t)w[i] - v.w[i] - borrow;
+            w[i] = (uint32_t)x;
+            borrow = (x >> 32) & 1;
+        }
+        if (borrow > 0) {
+            uint64_t carry = 0;
+            for (int i = 0; i < 8; i++) {
+                uint64_t x = (uint64_t)w[i] + _M[i] + carry;
+                w[i] = (uint32_t)x;
+                carry = x >> 32;
+            }
+        }
+        return *this;
+    }
+    Mod256& operator*=(const Mod256& v) {
+        uint32_t t[16];
+        mul(w, v.w, t);
+        fold(t);
+        for (int i = 0; i < 8; i++) w[i] = t[i];
+        reduce(0);
+        return *this;
+    }
+    friend const Mod256 operator+(const Mod256& v1, const Mod256& v2) { return Mod256(v1) += v2; }
+    friend const Mod256 operator-(const Mod256& v1, const Mod256& v2) { return Mod256(v1) -= v2; }
+    friend const Mod256 operator*(const Mod256& v1, const Mod256& v2) { return Mod256(v1) *= v2; }
+    friend bool operator==(const Mod256& v1, const Mod256& v2) { return cmp(v1.w, v2.w) == 0; }
+    friend bool operator!=(const Mod256& v1, const Mod256& v2) { return cmp(v1.w, v2.w) != 0; }
+};
+
+// secp256k1 moduli in words, along with c = 2^256 - m
+static const uint32_t p0_[8] = { 0xfffffc2f, 0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+static const uint32_t p0c_[2] = { 0x000003d1, 0x00000001 };
+static const uint32_t q0_[8] = { 0xd0364141, 0xbfd25e8c, 0xaf48a03b, 0xbaaedce6, 0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff };
+static const uint32_t q0c_[5] = { 0x2fc9bebf, 0x402da173, 0x50b75fc4, 0x45512319, 0x00000001 };
+
+// secp256k1 base field and scalar field
+using Fp0 = Mod256_t<p0_, p0c_, 2>;
+using Fq0 = Mod256_t<q0_, q0c_, 5>;
+
+// field inversion, addition chain for p - 2 (same as libsecp256k1)
+template<>
+inline Fp0 Fp0::inv() const
+{
+    const Fp0 &a = *this;
+    Fp0 x2 = a.sqr() * a;
+    Fp0 x3 = x2.sqr() * a;
+    Fp0 x6 = x3.sqr(3) * x3;
+    Fp0 x9 = x6.sqr(3) * x3;
+    Fp0 x11 = x9.sqr(2) * x2;
+    Fp0 x22 = x11.sqr(11) * x11;
+    Fp0 x44 = x22.sqr(22) * x22;
+    Fp0 x88 = x44.sqr(44) * x44;
+    Fp0 x176 = x88.sqr(88) * x88;
+    Fp0 x220 = x176.sqr(44) * x44;
+    Fp0 x223 = x220.sqr(3) * x3;
+    Fp0 t = x223.sqr(23) * x22;
+    t = t.sqr(5) * a;
+    t = t.sqr(3) * x2;
+    return t.sqr(2) * a;
+}
+
+// field square root, addition chain for (p + 1) / 4, must be checked by the caller
+static Fp0 secp256k1_sqrt(const Fp0 &a)
+{
+    Fp0 x2 = a.sqr() * a;
+    Fp0 x3 = x2.sqr() * a;
+    Fp0 x6 = x3.sqr(3) * x3;
+    Fp0 x9 = x6.sqr(3) * x3;
+    Fp0 x11 = x9.sqr(2) * x2;
+    Fp0 x22 = x11.sqr(11) * x11;
+    Fp0 x44 = x22.sqr(22) * x22;
+    Fp0 x88 = x44.sqr(44) * x44;
+    Fp0 x176 = x88.sqr(88) * x88;
+    Fp0 x220 = x176.sqr(44) * x44;
+    Fp0 x223 = x220.sqr(3) * x3;
+    Fp0 t = x223.sqr(23) * x22;
+    t = t.sqr(6) * x2;
+    return t.sqr(2);
+}
+
+// a short weierstrass point (A = 0) in jacobian coordinates over a fixed width field
+// the point at infinity has z = 0
+template<class Fp>
+struct Jacobian_t {
+    using Point0 = Jacobian_t;
+    using Fp0 = Fp;
+    Fp0 x, y, z;
+    bool is_inf() const { return z.is_zero(); }
+    void inf() { x = Fp0::of(1); y = Fp0::of(1); z = Fp0::of(0); }
+    Point0 operator-() const { Point0 p = *this; p.y = -y; return p; }
+    Point0 twice() const {
+        Fp0 a = x.sqr();
+        Fp0 b = y.sqr();
+        Fp0 c = b.sqr();
+        Fp0 d = (x + b).sqr() - (a + c); d += d;
+        Fp0 e = a + a + a;
+        Fp0 f = e.sqr();
+        Fp0 c8 = c + c; c8 += c8; c8 += c8;
+        Point0 p;
+        p.x = f - (d + d);
+        p.y = e * (d - p.x) - c8;
+        p.z = y * z; p.z += p.z;
+        return p;
+    }
+    // mixed addition of an affine point
+    Point0& add(const Fp0 &x2, const Fp0 &y2) {
+        if (is_inf()) { x = x2; y = y2; z = Fp0::of(1); return *this; }
+        Fp0 z1z1 = z.sqr();
+        Fp0 u2 = x2 * z1z1;
+        Fp0 s2 = y2 * z * z1z1;
+        Fp0 h = u2 - x;
+        Fp0 r = s2 - y;
+        if (h.is_zero()) {
+            if (r.is_zero()) *this = twice(); else inf();
+            return *this;
+        }
+        Fp0 hh = h.sqr();
+        Fp0 i = hh + hh; i += i;
+        Fp0 j = h * i;
+        r += r;
+        Fp0 v = x * i;
+        Fp0 yj = y * j;
+        Fp0 _x = r.sqr() - (j + v + v);
+        y = r * (v - _x) - (yj + yj);
+        z = (z + h).sqr() - (z1z1 + hh);
+        x = _x;
+        return *this;
+    }
+    Point0& operator+=(const Point0 &b) {
+        if (b.is_inf()) return *this;
+        if (is_inf()) { *this = b; return *this; }
+        Fp0 z1z1 = z.sqr();
+        Fp0 z2z2 = b.z.sqr();
+        Fp0 u1 = x * z2z2;
+        Fp0 u2 = b.x * z1z1;
+        Fp0 s1 = y * b.z * z2z2;
+        Fp0 s2 = b.y * z * z1z1;
+        Fp0 h = u2 - u1;
+        Fp0 r = s2 - s1;
+        if (h.is_zero()) {
+            if (r.is_zero()) *this = twice(); else inf();
+            return *this;
+        }
+        Fp0 i = (h + h).sqr();
+        Fp0 j = h * i;
+        r += r;
+        Fp0 v = u1 * i;
+        Fp0 sj = s1 * j;
+        x = r.sqr() - (j + v + v);
+        y = r * (v - x) - (sj + sj);
+        z = ((z + b.z).sqr() - (z1z1 + z2z2)) * h;
+        return *this;
+    }
+};
+using Point0 = Jacobian_t<Fp0>;
+
+// secp256k1 endomorphism constants, (x, y) -> (beta * x, y) = lambda * (x, y)
+static const Fp0 secp256k1_beta = {{ 0x719501ee, 0xc1396c28, 0x12f58995, 0x9cf04975, 0xac3434e9, 0x6e64479e, 0x657c0710, 0x7ae96a2b }};
+static const Fq0 secp256k1_lambda = {{ 0x1b23bd72, 0xdf02967c, 0x20816678, 0x122e22ea, 0x8812645a, 0xa5261c02, 0xc05c30e0, 0x5363ad4c }};
+
+// splits k into k1 + k2 * lambda with k1 and k2 at most 128 bits in absolute value
+// signs are returned apart, the halves hold the absolute values
+static void secp256k1_split(const Fq0 &k, Fq0 &k1, bool &neg1, Fq0 &k2, bool &neg2)
+{
+    // g1 = round(2^384 * b2 / q), g2 = round(2^384 * -b1 / q), as in libsecp256k1
+    static const uint32_t g1[8] = { 0x45dbb031, 0xe893209a, 0x71e8ca7f, 0x3daa8a14, 0x9284eb15, 0xe86c90e4, 0xa7d46bcd, 0x3086d221 };
+    static const uint32_t g2[8] = { 0x8ac47f71, 0x1571b4ae, 0x9df506c6, 0x221208ac, 0x0abfe4c4, 0x6f547fa9, 0x010e8828, 0xe4437ed6 };
+    static const Fq0 minus_b1 = {{ 0x0abfe4c3, 0x6f547fa9, 0x010e8828, 0xe4437ed6, 0x00000000, 0x00000000, 0x00000000, 0x00000000 }};
+    static const Fq0 minus_b2 = {{ 0x3db1562c, 0xd765cda8, 0x0774346d, 0x8a280ac5, 0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff }};
+
+    Fq0 c[2];
+    const uint32_t *g[2] = { g1, g2 };
+    for (int n = 0; n < 2; n++) {
+        uint32_t t[16];
+        Fq0::mul(k.w, g[n], t);
+        uint64_t carry = t[11] >> 31;
+        for (int i = 0; i < 8; i++) {
+            uint64_t x = (i < 4 ? (uint64_t)t[12+i] : 0) + carry;
+            c[n].w[i] = (uint32_t)x;
+            carry = x >> 32;
+        }
+    }
+    k2 = c[0] * minus_b1 + c[1] * minus_b2;
+    k1 = k - k2 * secp256k1_lambda;
+    neg1 = k1.is_high();
+    neg2 = k2.is_high();
+    if (neg1) k1 = -k1;
+    if (neg2) k2 = -k2;
+}
+
+// width-w non-adjacent form recoding of a small fixed width scalar
+static uint64_t wnaf(const Fq0 &scalar, int w, int8_t *naf, uint64_t size)
+{
+    uint32_t k[9];
+    for (int i = 0; i < 8; i++) k[i] = scalar.w[i];
+    k[8] = 0;
+    uint64_t count = 0;
+    for (;;) {
+        uint32_t nz = 0;
+        for (int i = 0; i < 9; i++) nz |= k[i];
+        if (nz == 0) break;
+        assert(count < size);
+        int d = 0;
+        if ((k[0] & 1) > 0) {
+            d = k[0] & ((1 << w) - 1);
+            if (d >= (1 << (w - 1))) d -= 1 << w;
+            uint64_t carry = d < 0 ? -d : 0;
+            uint64_t borrow = d > 0 ? d : 0;
+            for (int i = 0; i < 9; i++) {
+                uint64_t x = (uint64_t)k[i] + carry - borrow;
+                k[i] = (uint32_t)x;
+                carry = x >> 32 == 1 ? 1 : 0;
+                borrow = x >> 32 > 1 ? 1 : 0;
+            }
+        }
+        naf[count++] = d;
+        for (int i = 0; i < 8; i++) k[i] = (k[i] >> 1) | (k[i+1] << 31);
+        k[8] >>= 1;
+    }
+    return count;
+}
+
+// odd multiples G, 3G, ..., 127G of the generator and their endomorphism
+// images, in affine coordinates, as a literal table of x, beta * x and y
+template<class Fp0>
+struct Table_t {
+    static constexpr int W = 8;
+    static constexpr int T = 1 << (W - 2);
+    Fp0 x[T], bx[T], y[T];
+};
+using Table0 = Table_t<Fp0>;
+static const Table0 secp256k1_table = {
+    {   // x
+        {{ 0x16f81798, 0x59f2815b, 0x2dce28d9, 0x029bfcdb, 0xce870b07, 0x55a06295, 0xf9dcbbac, 0x79be667e }},
+        {{ 0xbce036f9, 0x8601f113, 0x836f99b0, 0xb531c845, 0xf89d5229, 0x49344f85, 0x9258c310, 0xf9308a01 }},
+        {{ 0xb240efe4, 0xcba8d569, 0xdc619ab7, 0xe88b84bd, 0x0a5c5128, 0x55b4a725, 0x1a072093, 0x2f8bde4d }},
+        {{ 0xcac4f9bc, 0xe92bdded, 0x0330e39c, 0x3d419b7e, 0xf2ea7a0e, 0xa398f365, 0x6e5db4ea, 0x5cbdf064 }},
+        {{ 0xfc27ccbe, 0xc35f110d, 0x4c57e714, 0xe0979697, 0x9f559abd, 0x09ad178a, 0xf0c7f653, 0xacd484e2 }},
+        {{ 0x5da008cb, 0xbbec1789, 0xe5c17891, 0x5649980b, 0x70c65aac, 0x5ef4246b, 0x58a9411e, 0x774ae7f8 }},
+        {{ 0x19405aa8, 0xdeeddf8f, 0x610e58cd, 0xb075fbc6, 0xc3748651, 0xc7d1d205, 0xd975288b, 0xf28773c2 }},
+        {{ 0xe27e080e, 0x44adbcf8, 0x3c85f79e, 0x31e5946f, 0x095ff411, 0x5a465ae3, 0x7d43ea96, 0xd7924d4f }},
+        {{ 0x4a2d4a34, 0x66e4faa0, 0x79b97687, 0xeb9898ae, 0x07eacf21, 0xa420fee8, 0xdb677750, 0xdefdea4c }},
+        {{ 0x38385b6c, 0x74756561, 0xd7e86d27, 0xf06acfeb, 0x444f4979, 0x93ef5cff, 0x97a443d2, 0x2b4ea0a7 }},
+        {{ 0x25be59d5, 0x81340aef, 0x71f81071, 0x1d9ad402, 0x2ce33330, 0x4f93fa33, 0x4cdd1256, 0x352bbf4a }},
+        {{ 0x4ecacc3f, 0xdc9cdadd, 0xeff5ff29, 0xe42ab8df, 0x59879124, 0x02300105, 0x6b38d11b, 0x2fa2104d }},
+        {{ 0xf5453714, 0x69ca0cd7, 0xe09572e2, 0x263c3d84, 0x66edda83, 0xab21a9b0, 0x09b4d68d, 0x9248279b }},
+        {{ 0x3dee8729, 0x7e996d44, 0x4bf615c0, 0x2f570e14, 0xb0beb752, 0x8e70132f, 0xe3a8bf27, 0xdaed4f2b }},
+        {{ 0x7d22e7db, 0xe6a3b5e8, 0xfdf281b0, 0x11ecd9e9, 0xcbb19f90, 0x8acf28d7, 0x065d812e, 0xc44d12c7 }},
+        {{ 0xd269e6b4, 0xb61c65cb, 0x36c28063, 0x152b6953, 0xded60853, 0xc89a20cf, 0xdc698504, 0x6a245bf6 }},
+        {{ 0x0d0bd6a5, 0xf95ae57f, 0x0bec1146, 0xce13300b, 0xfe541084, 0xc077e3d2, 0xfd9de627, 0x1697ffa6 }},
+        {{ 0xf27a7479, 0xf982345e, 0xffb7f61d, 0x9deb8360, 0xe834cb0d, 0x986d0f07, 0x9981718b, 0x605bdb01 }},
+        {{ 0xd87ff33d, 0xfe31c7e9, 0x4959b10c, 0xdcb01c35, 0x5a215e10, 0x7402fdc4, 0x4150bf49, 0x62d14dab }},
+        {{ 0x86308b6f, 0x5e555c2f, 0x6b9b8b42, 0x2c50e9f5, 0xc408e56b, 0xde5b4b06, 0x040f27da, 0x80c60ad0 }},
+        {{ 0xfa03c8fb, 0x9d5eabb0, 0x87d84704, 0x4cc5dc94, 0x8cc54d34, 0xaa74c634, 0x6167ad54, 0x7a9375ad }},
+        {{ 0x9bc3ffc9, 0x4bb51f45, 0x9b68df50, 0xbb408ec3, 0x45447a79, 0x907a9ed0, 0xb696b54c, 0xd528ecd9 }},
+        {{ 0xf8b45963, 0x87231808, 0x4a7ecb13, 0x5266115e, 0xe8ecdad0, 0xea25f514, 0xb5f43412, 0x049370a4 }},
+        {{ 0xfc345d74, 0xf1c13eb1, 0x0e1498e2, 0x881d811e, 0xd64702ef, 0xd73df930, 0x6ee88cbb, 0x77f23093 }},
+        {{ 0x7739f530, 0xeb28531b, 0xab9d4dba, 0x58c80074, 0x5c7c0bce, 0xea44887e, 0xcc4ce4b9, 0xf2dac991 }},
+        {{ 0xc690d45b, 0xbcba4850, 0xc9dae3de, 0x5a216cdf, 0xbe252012, 0x1b4be8fb, 0x662621fb, 0x463b3d9f }},
+        {{ 0x9998f247, 0xa32496b4, 0x4328a2d1, 0x6b98fac1, 0xff3b5997, 0x09232d4a, 0x44e46e2a, 0xf16f8042 }},
+        {{ 0x151d41d1, 0x369e15f7, 0xace27c65, 0x5d245315, 0x14311af5, 0xb0352b7a, 0x2dc84563, 0xcaf75427 }},
+        {{ 0x6f082120, 0x24497bc8, 0xcb86d7c1, 0x44a09c07, 0x09979d8b, 0xf85d0f17, 0x282cb986, 0x2600ca4b }},
+        {{ 0x6998e435, 0xc602a774, 0xe24f7dc8, 0x01c48685, 0xd12220bc, 0x338ec53c, 0xd7e8432c, 0x7635ca72 }},
+        {{ 0xbf56cc18, 0xc1a50743, 0x79d468fb, 0xb7f2b334, 0xdeee8a66, 0xdbbf4a87, 0xf325570c, 0x754e3239 }},
+        {{ 0x91d9b9e8, 0x9fe26946, 0x1d1c952f, 0x33080066, 0x82d570f0, 0xff57859c, 0x71a1e96a, 0xe3e6bd10 }},
+        {{ 0xf04aa6eb, 0x4cc47fdc, 0x2ba35f4b, 0xc4ccb1f3, 0x8f732985, 0x26ae73d8, 0x056a0338, 0x186b483d }},
+        {{ 0x4ce0963f, 0x1a832172, 0xb737d9c9, 0x5442e6d2, 0xf4be4f72, 0x44c98561, 0xb9876ce5, 0xdf9d70a6 }},
+        {{ 0x34ce7143, 0x5de64c5f, 0x849ed899, 0xab52554f, 0xd5dce0f8, 0x497ca815, 0x3c51e87a, 0x5edd5cc2 }},
+        {{ 0x84614fba, 0x722d362f, 0xc355b17a, 0x7aa3fba1, 0x287e9e77, 0xda12fe02, 0xb6476830, 0x290798c2 }},
+        {{ 0xf4053b45, 0x62dfdece, 0xe3602573, 0xcd29552f, 0xa150ac39, 0x054754ef, 0x95d9f5b3, 0xaf3c423a }},
+        {{ 0xd884249a, 0x8d2fed50, 0x6dcf98df, 0x06bb66b2, 0x99bf2749, 0xcccaa28c, 0xd134e745, 0x766dbb24 }},
+        {{ 0x191abe3e, 0xce92e666, 0x6c596a58, 0x45f7b44f, 0x3784f416, 0xa21277c3, 0x8c94759b, 0x59dbf46f }},
+        {{ 0x8cfd87b8, 0xb62dc601, 0x1a95e73c, 0xdd647e71, 0x74e9a4a8, 0x305e691e, 0x103c4537, 0xf13ada95 }},
+        {{ 0x5a88522c, 0x48855001, 0x6ebadfb6, 0xda1869c0, 0xc59cca4c, 0x6d4167a2, 0x0e8aced0, 0x7754b4fa }},
+        {{ 0xe2262519, 0xa6828c99, 0xde8041d2, 0x01858f95, 0x6abef9d7, 0xaa3874d4, 0x5990e048, 0x948dcadf }},
+        {{ 0x3d7c77ab, 0x70328a8a, 0xac0bfa15, 0xfb224cf5, 0x8202ec37, 0x89c7b48f, 0x50c76c16, 0x79624144 }},
+        {{ 0x37ec47ca, 0xb0dd0851, 0x25b8847b, 0x5a169772, 0x44d91548, 0xb15b1606, 0x34964b54, 0x35140878 }},
+        {{ 0x7b527eaf, 0x42943d3f, 0x8df787b4, 0x93e947eb, 0xdd8bc549, 0xc79ce2c9, 0x6b483e4b, 0xd3cc30ad }},
+        {{ 0xf4847610, 0x3975ba0f, 0xb913f649, 0x2b29823d, 0xbfefe08b, 0xce1c78fc, 0x80732860, 0x1624d847 }},
+        {{ 0x5fc61cd4, 0x6df7b4fd, 0x5af207da, 0x5192474b, 0x33e62a98, 0x6902c956, 0xa955a8a2, 0x733ce80d }},
+        {{ 0xb81c045c, 0xef258dfa, 0x2171e699, 0x8966c509, 0xbbd3b49f, 0xcf1a1c33, 0x54945064, 0x15d94412 }},
+        {{ 0xd0717940, 0xac138599, 0x9d2b8aaa, 0x1c21417c, 0x5ce70d27, 0xb612136e, 0xec9de675, 0xa1d0fcf2 }},
+        {{ 0x1cb36980, 0xc7ca3733, 0xe8245c06, 0xa790bade, 0x5f84dbe9, 0x5780c073, 0xc0af8ccc, 0xe22fbe15 }},
+        {{ 0x46cfa9b3, 0x40094522, 0x4704eaa7, 0x69635e39, 0xc1155f5f, 0x0ee13473, 0x9860e8e2, 0x311091dd }},
+        {{ 0x2ec2dbdf, 0x1867d423, 0x5a934078, 0x883928b4, 0xd3e6ac24, 0xb31c0442, 0xd301be89, 0x34c1fd04 }},
+        {{ 0x049b8d63, 0xcc2a5e6b, 0xbcd08aff, 0x8d13f3ab, 0x557eb42a, 0x1c14de5b, 0x6b54701c, 0xf219ea5d }},
+        {{ 0x69a0b448, 0x72369124, 0xbca62708, 0x543a5490, 0x8f45de26, 0xb1f683db, 0x74a8fbaa, 0xd7b8740f }},
+        {{ 0x1aa824bf, 0x9fe4d309, 0xabdd9428, 0xad5bcd32, 0xd3a3335e, 0xf86f7c98, 0x2f8f6f0e, 0x32d31c22 }},
+        {{ 0xc18347b5, 0x340f86cb, 0xd59592c4, 0x8793d77c, 0x5d9831ea, 0x71045a15, 0x914ab326, 0x7461f371 }},
+        {{ 0xd7b2b2d6, 0x287698ba, 0x3e67453d, 0x6d716b2c, 0xaa38206a, 0x74356a25, 0x1df18600, 0xee079adb }},
+        {{ 0xba9da6b5, 0x2bfd8616, 0x874c9dc7, 0xe65de331, 0x2ee620f7, 0x467b1830, 0x47ec83f0, 0x16ec93e4 }},
+        {{ 0xd537bd99, 0x85b96065, 0xf98b6aa4, 0xd8855897, 0xafa70b6b, 0x38978290, 0xc245f6f0, 0xeaa5f980 }},
+        {{ 0x35a49f51, 0xa96c4b6b, 0x7151342e, 0x58ae0487, 0x0a024399, 0x692ee191, 0x544ac132, 0x078c9407 }},
+        {{ 0x702857a5, 0x726578d9, 0x7a6fc688, 0x01cdc8ae, 0x431aea00, 0x16dcd838, 0x19a1a770, 0x494f4be2 }},
+        {{ 0x5c1fe9b5, 0xbf4c1e66, 0x58faa70e, 0xd28211ea, 0x144ea549, 0x6bc7f2f5, 0x0da6d86c, 0xa598a803 }},
+        {{ 0x58595997, 0x4dbadc3e, 0x12570a18, 0x208f020f, 0x2dbeafec, 0x09192f5f, 0x5abb2b5d, 0xc4191636 }},
+        {{ 0x14742881, 0xe4c73a55, 0xe0a36acf, 0x92a2e0d2, 0xda03bc5b, 0x5a724604, 0xa586fa47, 0x841d6063 }}
+    },
+    {   // bx
+        {{ 0x00b88fcb, 0xa7bba044, 0x7f15e98d, 0x87284406, 0x96902325, 0xab0102b6, 0x9da01887, 0xbcace2e9 }},
+        {{ 0x77206b2f, 0xf7f0728c, 0xc6dc8e1c, 0x8af1e022, 0x2a28fa2f, 0x8dcd8dcf, 0x731f9b4b, 0xdf6edf03 }},
+        {{ 0x95a83668, 0x138c6946, 0xe0d097cc, 0xa045693e, 0xccb94671, 0xf79f54fb, 0xacda49df, 0x337b52e3 }},
+        {{ 0x4e53bc94, 0x3bc4686e, 0x0faf7aaa, 0x0d3b20e2, 0xc095c06e, 0xa4fec4d1, 0x4bea0b77, 0x13f26e75 }},
+        {{ 0x65953a52, 0x20cd912e, 0xef6d44e1, 0xb565cdf5, 0xec58ab20, 0x7b6558af, 0x7e44e819, 0x87b40403 }},
+        {{ 0xbb209ce7, 0xc5ff4334, 0x0b5ff620, 0x79859bb7, 0xbebf1a26, 0x8d897c41, 0x171dac1d, 0x51f4d3d1 }},
+        {{ 0x475fb678, 0x60aaee6a, 0x4a3d0562, 0x32907ed7, 0x78fc783b, 0x07046c45, 0x4bb890a2, 0xf14d5837 }},
+        {{ 0x71b1b3b4, 0x3ac0a40c, 0xc1c0a639, 0x05cc3bc9, 0x512b6948, 0x0e1b4825, 0xf5f9454a, 0x805f1105 }},
+        {{ 0xf6433cc9, 0xc640b26a, 0xa6754102, 0x5cd58547, 0xc8986867, 0xdd08754c, 0xa1f110e2, 0xc2e95843 }},
+        {{ 0x2ed76769, 0x5d2eb914, 0xd78eeb1c, 0x57bafb25, 0xbfc45cc5, 0x3272082d, 0x5a6bb0f6, 0x54f51a8f }},
+        {{ 0x69cbbc35, 0x2fdeaab0, 0x809f2969, 0x592bc884, 0x0a204325, 0xa63d667a, 0x9b7e452e, 0x680eb70f }},
+        {{ 0x788930fc, 0xb6704dce, 0x34a09b26, 0x47c5360f, 0x3aed4da4, 0xcfe162a0, 0x1659bc6e, 0xbae0440b }},
+        {{ 0xef3195be, 0x8d758e87, 0x8400aa85, 0xe15b71f6, 0x301d395f, 0x1f7497e0, 0x5468c831, 0xf7554ece }},
+        {{ 0xf61b7229, 0x837a2dfe, 0x1318a794, 0x546322c6, 0x1ac76911, 0x1d6d435f, 0xe497be98, 0x8ca980cf }},
+        {{ 0xd53ba020, 0xc5c56571, 0x119bd70c, 0x1b9c0525, 0x0658f9eb, 0x188c807e, 0x73b31775, 0xe48590b3 }},
+        {{ 0xafac1b9b, 0x8f8022a6, 0x5945eb46, 0x20ba5001, 0x83b19a3a, 0xe84d2751, 0xdae527c2, 0xe6034c74 }},
+        {{ 0xae44e551, 0x4457db1d, 0xe0674325, 0x1fa0e628, 0x408c8fa1, 0x73175272, 0x7daab599, 0xd3ea4060 }},
+        {{ 0x7429b03f, 0xb5888b9a, 0x5494174b, 0xa473aa2f, 0x234e9878, 0x6851dcdf, 0x4f8f79e9, 0x7ff6966b }},
+        {{ 0x045cfcb3, 0xeb070ef4, 0x018d2aad, 0xd1acc036, 0x94e4ec59, 0x554ce32c, 0xed4c54af, 0xab880849 }},
+        {{ 0x3e1f51a1, 0xef4eadd8, 0x94af5f75, 0x3aa695ac, 0xa9fccfdf, 0xfaa581fb, 0x8fa96dbd, 0x148d9eee }},
+        {{ 0x6a19f543, 0x30e6211e, 0x3c35304c, 0xc7b2def8, 0xfdba68ba, 0x6bc8823e, 0xb8769193, 0xc5011eac }},
+        {{ 0x3b5e25e7, 0x60bb6fa3, 0xec823ea9, 0x3fa22df8, 0x4a9bd852, 0x89eb86d5, 0xf658169b, 0xe9c9d489 }},
+        {{ 0x4351973d, 0x06ba66db, 0xeeb1662d, 0xb9af414e, 0x9f6c352e, 0x4abe8c11, 0x71eb0aa7, 0x5e51873a }},
+        {{ 0x30323cac, 0x575e3121, 0x10a2ed1d, 0xe26f62cd, 0x4dce1c4f, 0x0cf2d3ea, 0xc8a81c44, 0xa0a5df60 }},
+        {{ 0x6d0865ee, 0xa9b4c1e6, 0x18ec3d0d, 0xd68631e9, 0xa1c0ba81, 0x8cce3ff1, 0x7965eff5, 0x88bf8290 }},
+        {{ 0xa6151ccd, 0xdb2eb2c6, 0xf4120947, 0x2ee49dc8, 0x461c8f85, 0xa273c509, 0x9f38f50e, 0xd3d89800 }},
+        {{ 0xbb643650, 0xf8e4228d, 0x8c9cdda6, 0xe618bd70, 0xc186e54d, 0xe68c6222, 0x422ead4a, 0xaaaa6ea8 }},
+        {{ 0x14a4f300, 0xd41882a1, 0x95505fa9, 0xb7f55b54, 0xe329e931, 0x783f1d5b, 0xc50b7cf2, 0x9bdf1191 }},
+        {{ 0x0cb65103, 0x0abd2206, 0x4d3f70f9, 0xe3d8d792, 0x3b922921, 0x77df55e4, 0x1cfcff60, 0x6c89c339 }},
+        {{ 0xd0e6c1cf, 0x7b55a11e, 0x67d378fa, 0xc139c7ab, 0xa5cf654a, 0x361baf7a, 0x0632ec3a, 0xfb81bec0 }},
+        {{ 0x101c2518, 0x0d769207, 0xfd8b3e68, 0xf6cdff78, 0xd347db19, 0x6228149a, 0x26ddc9f5, 0xbe02db96 }},
+        {{ 0x6baeef76, 0xc17b586f, 0xa550463e, 0xaf721aa9, 0x0889d21d, 0x17563587, 0x1c28c565, 0x87bd9a8f }},
+        {{ 0x58d30e3f, 0xa7280311, 0xb9624747, 0xfaa0dddb, 0x002f9697, 0x82602c3c, 0x4e57f39e, 0x2b6a7360 }},
+        {{ 0x1c6074db, 0x59193213, 0x64893824, 0x7c28977d, 0x6c793132, 0xeadce5ac, 0xf8586658, 0x689ff442 }},
+        {{ 0x5add7b20, 0xd5e63c7c, 0x36a3c416, 0x89d9b6de, 0x892900c3, 0x79fbe4c3, 0x642bc765, 0x3c431ae2 }},
+        {{ 0x9bfe323b, 0xdfb85841, 0x8ccd0198, 0xcce185ad, 0x26c20244, 0xf9aefb91, 0xb9f78798, 0x30571001 }},
+        {{ 0xe701991a, 0x86e92a72, 0x8ba9ced5, 0x9ad44200, 0x183e8dcb, 0x5edab57a, 0x8326f2b8, 0x00d263ad }},
+        {{ 0xb2e63cf9, 0xeb258f4d, 0x6ac298be, 0x41290bdf, 0x6f2903f8, 0x70dc5ba7, 0x67de3fdd, 0x3cff41ca }},
+        {{ 0x6c079ef2, 0x4bf07a87, 0x58a6076b, 0xb65cb885, 0xe64efd81, 0x1fb0e230, 0x83b1bf52, 0x04c5c143 }},
+        {{ 0x095052c4, 0x7998212e, 0x30db955f, 0xb1e99c30, 0x90063187, 0x3070fdba, 0x37bb6706, 0x86c98957 }},
+        {{ 0x2be7dba3, 0xd7c4e0c1, 0x1cc01df6, 0x2990a5aa, 0xb60af467, 0x4dac8fdc, 0x8e5cec56, 0x8f4c4a00 }},
+        {{ 0xd20c3970, 0x55b863ad, 0x202526a1, 0xce7f2d98, 0x68bbd810, 0x45332a03, 0x0e9e7708, 0x9cd29229 }},
+        {{ 0x100b5d72, 0xbac23033, 0xb751f987, 0xa1bc0cf2, 0xb641d0c1, 0xc611b701, 0x7ea43db6, 0x8e5ccf4e }},
+        {{ 0x5498d815, 0x9f0aca6c, 0x698c6afb, 0x5a885c86, 0xa79a40ac, 0x13a5f96f, 0xb4d69021, 0x8036894b }},
+        {{ 0xb7b44e89, 0xb6d5cec8, 0x5db7e19f, 0x0e615846, 0x814be933, 0xba0ae6b3, 0x31b07052, 0xb524f8a3 }},
+        {{ 0x559f7bb4, 0x689d7429, 0xe44cc5a2, 0xa1179a0d, 0x15bc3c2a, 0xd1ced61c, 0x93816ae0, 0xcf045500 }},
+        {{ 0x7ca9bce6, 0x05ac5018, 0x4f51067f, 0xf4a4f9e3, 0x35025697, 0x37b2e3dc, 0x298a5973, 0x0ccbd8ba }},
+        {{ 0xe11a2857, 0x2eef9d7f, 0x376babae, 0xf1a04744, 0xfeefa7d9, 0xb696c0e3, 0xe84ea37a, 0x65384c59 }},
+        {{ 0x7de9a019, 0x94bb7921, 0x3a6ea125, 0x19c4a96a, 0xf8635b1e, 0x77cbb3ba, 0xa5a886c5, 0xd3231073 }},
+        {{ 0x00b8dbb6, 0xe3ed90c7, 0x129d49dc, 0xae79ae57, 0xba6e8944, 0x5605537f, 0xc1020a09, 0x55987956 }},
+        {{ 0x978d98be, 0xf2ca639e, 0x9853e177, 0x457399aa, 0x58d8d905, 0x3633e5b4, 0xf164bbe6, 0x92889fa7 }},
+        {{ 0xf6b22bb8, 0x44ff7627, 0x273d519c, 0xbace2a8a, 0xf5d1a0fb, 0xfcc6b989, 0x8f50aea2, 0x723284d2 }},
+        {{ 0xf4f97b56, 0x6795505b, 0xabb760f2, 0xfadf69e1, 0xdbb17512, 0xdf057d63, 0xa1cf7d21, 0x330d232f }},
+        {{ 0x6d76dfbf, 0x57f69688, 0xb7caf16a, 0xcb65335b, 0xe7abb401, 0x99cb563c, 0xd2e6d154, 0x90a8b67e }},
+        {{ 0x2c84596b, 0x890d88ce, 0x2905d4ba, 0x1479376c, 0x53f5d433, 0xb1675138, 0xf04301d9, 0x8f264368 }},
+        {{ 0xac307f42, 0x9ab88e9b, 0x4ab0be7f, 0x1e055411, 0x76fed794, 0xf9d9bf04, 0x07710d6c, 0x309d0965 }},
+        {{ 0xde1e873b, 0x291f70f8, 0x3a2f60ef, 0x79e054f1, 0x967a81d5, 0xd81c5d76, 0x99c9e044, 0x82929037 }},
+        {{ 0xf3f309bb, 0xd6372271, 0xd333fcf6, 0x0c9196c4, 0x6f7838e5, 0xf0c2ef7a, 0xbd30abde, 0xaad8f0b2 }},
+        {{ 0x526c24de, 0x58a60b22, 0xf4acbb50, 0x84bddb39, 0x622d9d32, 0xa4d06222, 0xcee183dd, 0x28eabe22 }},
+        {{ 0xaceb43f3, 0xb5f7d474, 0x86ccfd73, 0x7f7f90b0, 0xef778890, 0x533a9dd7, 0xc3358ecd, 0xaecdefd0 }},
+        {{ 0xfe399d2d, 0x1feb25a8, 0x42c7f9f1, 0xbfca43eb, 0xff3c2d67, 0xcaeeac7a, 0xb76c2c02, 0x4db9267b }},
+        {{ 0x32fae1ef, 0x631e0d83, 0xc77e1b62, 0xdf5daed4, 0x8a8d1e86, 0xd12ca4fd, 0xb70f60aa, 0x4a23f26e }},
+        {{ 0xb9a43852, 0x5a8add0f, 0xccf762f1, 0x82f1e9a3, 0xbed899bd, 0xfd6d55fb, 0xb07eb88c, 0xe378ca57 }},
+        {{ 0xb1038e42, 0xe6b55f70, 0x00b6172b, 0x6645a5ea, 0xa27043dd, 0xeeabb561, 0xc237ff97, 0xcf1f4919 }}
+    },
+    {   // y
+        {{ 0xfb10d4b8, 0x9c47d08f, 0xa6855419, 0xfd17b448, 0x0e1108a8, 0x5da4fbfc, 0x26a3c465, 0x483ada77 }},
+        {{ 0x84b8e672, 0x6cb9fd75, 0x34c2231b, 0x6500a999, 0x2a37f356, 0x0fe337e6, 0x632de814, 0x388f7b0f }},
+        {{ 0xa6ac62d6, 0xdca87d3a, 0xab0d6840, 0xf788271b, 0xa6c9c426, 0xd4dba9dd, 0x36e5e3d6, 0xd8ac2226 }},
+        {{ 0x087264da, 0xa5082628, 0x13fde7b5, 0xa813d0b8, 0x861a54db, 0xa3178d6d, 0xba255960, 0x6aebca40 }},
+        {{ 0xc64f9c37, 0x05cc262a, 0x375f8e0f, 0xadd888a4, 0x763b61e9, 0x64380971, 0xb0a7d9fd, 0xcc338921 }},
+        {{ 0xc953c61b, 0x301d74c9, 0xdff9d6a8, 0x372db1e2, 0xd7b7b365, 0x0243dd56, 0xeb6b5e19, 0xd984a032 }},
+        {{ 0xdb03ed81, 0x29b5cb52, 0x521fa91f, 0x3a1a06da, 0x65cdaf47, 0x758212eb, 0x8d880a89, 0x0ab0902e }},
+        {{ 0xf6a26b58, 0xc504dc9f, 0xd896d3a5, 0xea40af2b, 0x28cc6def, 0x83842ec2, 0xa86c72a6, 0x581e2872 }},
+        {{ 0x9e56eb77, 0xcfb199f6, 0x4a95c0f6, 0xced1f4a0, 0xd2a93dae, 0xe997b0ea, 0x94635168, 0x4211ab06 }},
+        {{ 0xe5c09b7a, 0xb570c854, 0x50269763, 0x1a01f60c, 0x5a1c8613, 0xb343083b, 0x37945d93, 0x85e89bc0 }},
+        {{ 0xcf81998c, 0x67bd3d8b, 0x71b1039c, 0x4a1b3b2e, 0x9dda3e1f, 0xd59c1825, 0x5348f534, 0x321eb407 }},
+        {{ 0x532b7d67, 0x423ba76b, 0xfc882648, 0x181d70ec, 0x5bd5dd80, 0xb6456933, 0x295dd865, 0x02de1068 }},
+        {{ 0x97cb3402, 0xe54a32ce, 0x887912ff, 0x3fc0de2a, 0xdea2b1ff, 0x5d1aa71b, 0xf234aade, 0x73016f7b }},
+        {{ 0x90be1c55, 0xab40e522, 0xf3afa726, 0x3f83c230, 0x7ef8d700, 0xd4a1aca8, 0x7d6c98e8, 0xa69dce4a }},
+        {{ 0x0e0e6482, 0xa039063f, 0x1edf61c5, 0x0e106e86, 0xc982fdac, 0x76c45926, 0xce326cdc, 0x2119a460 }},
+        {{ 0x100d8a82, 0xfd5e6348, 0xd0423b6e, 0x8b33ba48, 0xf16a24ad, 0x8b3f5126, 0xc2bd4a70, 0xe022cf42 }},
+        {{ 0xd01b2396, 0xadee9d63, 0x9e498ae7, 0xa2cf1500, 0xe4557433, 0x27561506, 0x86806f5d, 0xb9c398f1 }},
+        {{ 0x056b8c49, 0x3b01e1e9, 0x4fb14db4, 0xc26bfae8, 0xec96fe23, 0x81a78d93, 0xe4f8d206, 0x02972d2d }},
+        {{ 0x83b25eaf, 0x35f56424, 0x67ab4722, 0x01aa1329, 0x50eed0db, 0x98088a19, 0x8cc5b010, 0x80fc06bd }},
+        {{ 0x430bd57a, 0x1aa01f56, 0xbe7024eb, 0xa65eed4c, 0x7fe72f70, 0x26e66bad, 0x1cc5c30f, 0x1c38303f }},
+        {{ 0x224dc7f7, 0x02d499ec, 0x0c70ce2b, 0xbdc59ea1, 0x79269046, 0x09559e0d, 0xeca87269, 0x0d0e3fa9 }},
+        {{ 0x21409933, 0x063465b5, 0x5c520dbc, 0xbc434540, 0x81fd656e, 0x9966f218, 0x3136e5f9, 0xeecf4125 }},
+        {{ 0x12949c9a, 0xb653052a, 0xbb5b6764, 0x54c3f3af, 0x512fd62a, 0x8b3081b0, 0xafd6ed42, 0x758f3f41 }},
+        {{ 0x671c60d6, 0xbe8eb3c7, 0xd97077cb, 0x96c95330, 0x9ba1b378, 0x0a08266e, 0x7886b640, 0x958ef42a }},
+        {{ 0x703a3c37, 0x1a117dba, 0x0598e4fd, 0x9eb5fbeb, 0xec2531df, 0x4da1f32d, 0x3b2f8dad, 0xe0dedc9b }},
+        {{ 0x1af7307e, 0x1cb377b0, 0x970a1de3, 0xc622e27c, 0xdd8622d7, 0x43114306, 0x8c296c35, 0x5ed430d7 }},
+        {{ 0xc4e31df6, 0xd6579962, 0x6e5cce26, 0x2a6c53c2, 0xdf4e33d9, 0x13d206fc, 0x82203f7e, 0xcedabd9b }},
+        {{ 0x18a04476, 0xc32f9083, 0x962232a5, 0x5f4fa9b7, 0xa5e46057, 0xa41b643f, 0xef35f5f2, 0xcb474660 }},
+        {{ 0x5a7e4b40, 0x4b0be947, 0xab5f0ef4, 0x5ac6be74, 0xcddbb45d, 0xa693b03f, 0x53c15bd6, 0x4119b887 }},
+        {{ 0x2c5b9c61, 0xd9e76f30, 0xd57048ba, 0x4ecfc061, 0x0f78e6d7, 0x3d1d5e59, 0x09489d61, 0x091b6496 }},
+        {{ 0x3c536683, 0x0c5d9809, 0x197a695d, 0x23ee33d0, 0x04ea49a0, 0xb3cd0ed3, 0xe5bda30f, 0x0673fb86 }},
+        {{ 0x920e37f5, 0x67002af4, 0x93e90c41, 0xa5a22839, 0x379a3cb6, 0x40c0aa58, 0xa394e76f, 0x59c9e0bb }},
+        {{ 0x6e80888b, 0xa4a797f8, 0x895138b4, 0x21fb8090, 0x204180ab, 0x2e17446e, 0xc67cf77e, 0x3b952d32 }},
+        {{ 0xf2ba2417, 0x17b8c45c, 0x20ef9da2, 0xb1572227, 0x5dc39d4a, 0x5f862b78, 0xd84d6ccd, 0x55eb2daf }},
+        {{ 0x7399a868, 0xcdc706ab, 0xd17a2905, 0xc13c66c0, 0x30c89ad0, 0x61e8cec0, 0xbc141306, 0xefae9c8d }},
+        {{ 0x41943e7a, 0x6d003afd, 0xdb2a2314, 0x5b29c094, 0xf79af25d, 0x988d00bc, 0xcd440621, 0xe38da76d }},
+        {{ 0x498fd9c6, 0xbc2feded, 0x67a15581, 0xc8cd5aa6, 0xf35cfb40, 0x9a93b0e6, 0x31eb2b74, 0xf98a3fd8 }},
+        {{ 0xcbac5996, 0x2c924f97, 0xfa06cedd, 0x97584a65, 0x80da38b8, 0x8dcc8879, 0xeacbe5e3, 0x744b1152 }},
+        {{ 0x4a307f6e, 0xd85e216c, 0x7919798c, 0x42ce739a, 0x648309a0, 0x0f4ea6ce, 0x175fbc30, 0xc534ad44 }},
+        {{ 0xdaf5733d, 0x0778419b, 0x6a75c257, 0x6949e21a, 0x08341f32, 0x63bf4bc8, 0x4ee14de6, 0xe13817b4 }},
+        {{ 0x841163a2, 0x37a48b57, 0x0b6cbcc5, 0x8d1e4e35, 0x3020b8fa, 0x224b967c, 0x4e669d82, 0x30e93e86 }},
+        {{ 0x5347d57e, 0xcbba2cae, 0xbd2ef1d2, 0xdf9154ef, 0x24b1bc25, 0xd5d28a32, 0x37f6e597, 0xe491a425 }},
+        {{ 0x9db83437, 0x60afa5b2, 0x1f04ac57, 0x12507a05, 0x33ef6f6b, 0x0d5c1fc1, 0xc4ffb476, 0x100b610e }},
+        {{ 0xde293311, 0x7e7d15a0, 0x15c2378b, 0x6039e77c, 0x8e8127fc, 0x8e1652c4, 0x05620544, 0xef0afbb2 }},
+        {{ 0x4eede0a4, 0xafb34db0, 0x90358630, 0x3c2ad462, 0x8f9508ae, 0x89c5e9be, 0xd827278d, 0x8b378a22 }},
+        {{ 0x04078575, 0xcc06e2a4, 0x282be4c8, 0x896878f5, 0x6cd9d4ca, 0x0914448c, 0xb6da903e, 0x68651cf9 }},
+        {{ 0x1dc5ea1d, 0xc54673bc, 0x201e4578, 0x3e1ef8e0, 0x8db9fcce, 0x485a4d8b, 0xd2badf7d, 0xf5435a2b }},
+        {{ 0xefe4070d, 0xfc37bbe9, 0xcebfc685, 0x434800ba, 0x73b84177, 0x34f5137b, 0x69463e72, 0xd56eb30b }},
+        {{ 0xc197a629, 0x19212d39, 0x4070f3d5, 0x641462a5, 0x309667f2, 0xb2e90737, 0xbcb5a3ca, 0xedd77f50 }},
+        {{ 0x7d31da06, 0xe43d06d7, 0x4964799b, 0xa3828915, 0x9f53a1a7, 0x88b430a6, 0xad5cd60c, 0x0a855bab }},
+        {{ 0x286d8374, 0xbd80f0b1, 0x4feee685, 0x871ec5a6, 0x88c06830, 0xffd1f047, 0x87d1f04f, 0x66db656f }},
+        {{ 0xba73abee, 0xc5321857, 0xb487443d, 0xd57f1cee, 0x30174136, 0x54bd46f7, 0xe97b1b59, 0x09414685 }},
+        {{ 0x400766d1, 0xd8c2962a, 0x07b27fb8, 0xf4b08d3c, 0x4cccf6b1, 0xf73af454, 0xe83d40b0, 0x4cb95957 }},
+        {{ 0xeaa4593b, 0x411e0315, 0xd3c049b3, 0xff15db5e, 0x7ad4717e, 0xe1010f33, 0x28d9c92e, 0xfa779681 }},
+        {{ 0x462e1661, 0x118d14b8, 0x6f26e961, 0x2e6dac9e, 0x15b9e1da, 0x9ccd3d79, 0x892156e3, 0x5f3032f5 }},
+        {{ 0xcc092ff6, 0xb39847b3, 0x0c986ea6, 0x2eee1ff5, 0x0aa44254, 0xcbdddcae, 0x8b96bec0, 0x8ec0ba23 }},
+        {{ 0xec1c8c1e, 0xebaac479, 0xf04c4e25, 0xa446989a, 0xecc5f9f6, 0x4c5f37e0, 0xafe3be5c, 0x8dc2412a }},
+        {{ 0x25b0674d, 0x9626778e, 0x50e49713, 0x9d58186a, 0xca5804a3, 0xd0e8c2a7, 0x0e62fb40, 0x5e463115 }},
+        {{ 0x4edc07dc, 0xb1804102, 0x7e6ea67f, 0xd784869d, 0x1c994624, 0x19a52839, 0x292c2e08, 0xf65f5d3e }},
+        {{ 0x94a3ddb4, 0x62b675f1, 0x3c064d24, 0xfa1fbd58, 0x539a5e68, 0xd5404795, 0x69eb9b85, 0xf3e03191 }},
+        {{ 0x880d562c, 0x55f4b031, 0xd767ed6e, 0xf925ce30, 0x5e36ba2a, 0x39ba7f07, 0x9283a5f3, 0x42242a96 }},
+        {{ 0x2d864e6b, 0x10026dbd, 0x5b35f86a, 0x23fc63b6, 0x40737aec, 0x7e4b4a71, 0x84822c30, 0x204b5d6f }},
+        {{ 0x58fa9913, 0xed16e96b, 0x0f34bfc0, 0xd5caf945, 0x28984989, 0x49d245b3, 0xd0087efa, 0x04f14351 }},
+        {{ 0x1a8d6154, 0xe7a36de0, 0x744c169c, 0xe62562d6, 0xc7543698, 0x1904f9a1, 0x9c0659e8, 0x073867f5 }}
+    }
+};
+
+// computes u1 * G + u2 * R interleaving the four GLV halves (strauss-shamir)
+// the generator halves use the precomputed table with a wide window, while
+// R gets a small table of odd multiples built on the fly
+static Point0 secp256k1_mul2(const Fq0 &u1, const Point0 &R, const Fq0 &u2)
+{
+    static constexpr int W = 5;
+    static constexpr int T = 1 << (W - 2);
+    const Table0 &table = secp256k1_table;
+
+    Fq0 k[4]; bool neg[4];
+    secp256k1_split(u1, k[0], neg[0], k[1], neg[1]);
+    secp256k1_split(u2, k[2], neg[2], k[3], neg[3]);
+    int8_t naf[4][136];
+    uint64_t size[4];
+    uint64_t max = 0;
+    for (int j = 0; j < 4; j++) {
+        size[j] = wnaf(k[j], j < 2 ? Table0::W : W, naf[j], sizeof(naf[j]));
+        max = _max(max, size[j]);
+    }
+
+    Point0 rtable[2][T];
+    Point0 r2 = R.twice();
+    rtable[0][0] = R;
+    for (int i = 1; i < T; i++) { rtable[0][i] = rtable[0][i-1]; rtable[0][i] += r2; }
+    for (int i = 0; i < T; i++) {
+        rtable[1][i] = rtable[0][i];
+        rtable[1][i].x = rtable[0][i].x * secp256k1_beta;
+        if (neg[2]) rtable[0][i] = -rtable[0][i];
+        if (neg[3]) rtable[1][i] = -rtable[1][i];
+    }
+
+    Point0 sum; sum.inf();
+    for (uint64_t i = max; i > 0; i--) {
+        sum = sum.twice();
+        for (int j = 0; j < 2; j++) {
+            int d = i <= size[j] ? naf[j][i-1] : 0;
+            if (d == 0) continue;
+            int index = (d < 0 ? -d : d) / 2;
+            const Fp0 &x = j == 0 ? table.x[index] : table.bx[index];
+            if ((d < 0) != neg[j]) sum.add(x, -table.y[index]); else sum.add(x, table.y[index]);
+        }
+        for (int j = 2; j < 4; j++) {
+            int d = i <= size[j] ? naf[j][i-1] : 0;
+            if (d > 0) sum += rtable[j-2][d / 2];
+            if (d < 0) sum += -rtable[j-2][-d / 2];
+        }
+    }
+    return sum;
+}
+
+// recovers public keys for many signatures at once, for each one x = r, y comes from
+// the curve equation and the parity given by v, and then (-h * G + s * R) / r is computed
+// inversions of r and the final affine conversions are shared across the batch
+static void ecrecover(const uint256_t *_h, const uint256_t *_v, const uint256_t *_r, const uint256_t *_s, uint64_t count, G0 *points)
+{
+    local<uint8_t> buffer_l(64); uint8_t *buffer = buffer_l.data;
+    std::vector<Point0> t(count);
+    std::vector<Fq0> z(count);
+    std::vector<Fp0> zt(count);
+    for (uint64_t i = 0; i < count; i++) {
+        uint256_t::to(_r[i], buffer);
+        z[i] = Fq0::from(buffer);
+        t[i].x = Fp0::from(buffer);
+        Fp0 y2 = t[i].x.sqr() * t[i].x + Fp0::of(7);
+        Fp0 y = secp256k1_sqrt(y2);
+        if (y.sqr() != y2) { z[i] = Fq0::of(0); continue; }
+        t[i].y = (_v[i] == 28) != y.is_odd() ? -y : y;
+        t[i].z = Fp0::of(1);
+    }
+    Fq0::batch_inv(&z[0], count);
+    for (uint64_t i = 0; i < count; i++) {
+        if (z[i].is_zero()) { t[i].inf(); continue; }
+        uint256_t::to(_s[i], buffer);
+        Fq0 s = Fq0::from(buffer);
+        uint256_t::to(_h[i], buffer);
+        Fq0 h = Fq0::from(buffer);
+        t[i] = secp256k1_mul2(-h * z[i], t[i], s * z[i]);
+        zt[i] = t[i].z;
+    }
+    Fp0::batch_inv(&zt[0], count);
+    for (uint64_t i = 0; i < count; i++) {
+        if (t[i].is_inf()) { points[i] = G0(0, 0); continue; }
+        Fp0 zinv2 = zt[i].sqr();
+        Fp0::to(t[i].x * zinv2, &buffer[0]);
+        Fp0::to(t[i].y * zinv2 * zt[i], &buffer[32]);
+        points[i] = G0(bigint::from(&buffer[0], 32), bigint::from(&buffer[32], 32));
+    }
+}
 static G0 ecrecover(const uint256_t &_h, const uint256_t &_v, const uint256_t &_r, const uint256_t &_s)
 {
-    static const bigint P = big(p_);
-    static const bigint Q = big(q_);
-    static const G0 G = G0(
-        big("55066263022277343669578718895168534326250603453777594175500187360389116729240"),
-        big("32670510020758816978083085130507043184471273380659243275938904335757337482424")
-    );
-
-    bigint h = uint256_t::to_big(_h);
-    bigint v = uint256_t::to_big(_v);
-    bigint r = uint256_t::to_big(_r);
-    bigint s = uint256_t::to_big(_s);
-    bigint y = bigint::powmod(((r * r) % P * r) % P + 7, (P + 1) / 4, P);
-    if ((v == 28) == ((y % 2) == 0)) y = P - y;
-    G0 q(r, y);
-    if (!q.is_valid()) return G0(0, 0);
-    bigint u = Q - (h % Q);
-    bigint z = bigint::powmod(r, Q - 2, Q);
-    G0 t = ((q * s) + (G * u)) * z;
-    t = t.affine();
+    G0 t;
+    ecrecover(&_h, &_v, &_r, &_s, 1, &t);
     return t;
 }
 #endif // NATIVE_CRYPTO
 
+// checks the signature values against the ranges accepted for recovery
+static bool valid_signature(const uint256_t &v, const uint256_t &r, const uint256_t &s)
+{
+    static constexpr uint256_t P = u256(0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff, 0xfffffffefffffc2f);
+    if (v < 27 || v > 28) return false;
+    if (r == 0 || r >= P) return false;
+    if (s == 0) return false;
+    return true;
+}
+
 // secp256k1 publickey (in fact 160-bit address) recovery from signature
 // it follows the elliptic curve algorithm
 static uint160_t _throws(ecrecover)(const uint256_t &h, const uint256_t &v, const uint256_t &r, const uint256_t &s)
 {
-    static const uint256_t P = udec256(p_);
-    if (v < 27 || v > 28) _throw0(INVALID_SIGNATURE);
-    if (r == 0 || r >= P) _throw0(INVALID_SIGNATURE);
-    if (s == 0 || r >= P) _throw0(INVALID_SIGNATURE);
+    if (!valid_signature(v, r, s)) _throw0(INVALID_SIGNATURE);
     G0 t = ecrecover(h, v, r, s);
     if (t.is_inf()) _throw0(INVALID_SIGNATURE);
     local<uint8_t> buffer_l(64); uint8_t *buffer = buffer_l.data;
@@ -2443,8 +3616,10 @@ static uint160_t _throws(ecrecover)(const uint256_t &h, const uint256_t &v, cons
 // ** bn256 **
 
 // bn256 constants
-static const char P_[] = "21888242871839275222246405745257275088696311157297823662689037894645226208583";
-static const char Q_[] = "21888242871839275222246405745257275088548364400416034343698204186575808495617";
+static const uint32_t P_w_[8] = { 0xd87cfd47, 0x3c208c16, 0x6871ca8d, 0x97816a91, 0x8181585d, 0xb85045b6, 0xe131a029, 0x30644e72 };
+static const uint32_t Q_w_[8] = { 0xf0000001, 0x43e1f593, 0x79b97091, 0x2833e848, 0x8181585d, 0xb85045b6, 0xe131a029, 0x30644e72 };
+_bigconst(P_, P_w_, 8)
+_bigconst(Q_, Q_w_, 8)
 
 // bn256 curve/twist definitions
 using Gen2 = Gen2_t<P_>;
@@ -2454,6 +3629,8 @@ using G1 = CurvePoint_t<P_, 3>;
 using G2 = TwistPoint_t<Gen2, Q_>;
 
 // bn256 miller's pairing algorithm
+// line coefficients only depend on the twist point, the curve point
+// simply scales b and c, so lines are computed apart and can be reused
 static void mul_line(const Gen2 &a, const Gen2 &b, const Gen2 &c, Gen12 &inout)
 {
     Gen2 _0; _0 = 0;
@@ -2462,7 +3639,7 @@ static void mul_line(const Gen2 &a, const Gen2 &b, const Gen2 &c, Gen12 &inout)
     inout.x = (inout.x + inout.y) * Gen6(_0, a, b + c) - (t1 + t2);
     inout.y = t1.multau() + t2;
 }
-static G2 line_func_twice(const G1 &q, const G2 &r, Gen2 &a, Gen2 &b, Gen2 &c)
+static G2 line_func_twice(const G2 &r, Gen2 &a, Gen2 &b, Gen2 &c)
 {
     Gen2 A = r.x.sqr();
     Gen2 B = r.y.sqr();
@@ -2479,11 +3656,11 @@ static G2 line_func_twice(const G1 &q, const G2 &r, Gen2 &a, Gen2 &b, Gen2 &c)
     Gen2 M = B + B;
     Gen2 N = K * r.t;
     a = ((r.x + F).sqr() - (A + G)) - (M + M);
-    b = -(L + L) * q.x;
-    c = (N + N) * q.y;
+    b = -(L + L);
+    c = N + N;
     return G2(H, (E - H) * F - (J + J), K, K.sqr());
 }
-static G2 line_func_add(const G1 &q, const G2 &r, const G2 &p, const Gen2 &r2, Gen2 &a, Gen2&b, Gen2&c)
+static G2 line_func_add(const G2 &r, const G2 &p, const Gen2 &r2, Gen2 &a, Gen2&b, Gen2&c)
 {
     Gen2 A = ((p.y + r.z).sqr() - (r2 + r.t)) * r.t - (r.y + r.y);
     Gen2 B = p.x * r.t;
@@ -2498,70 +3675,134 @@ static G2 line_func_add(const G1 &q, const G2 &r, const G2 &p, const Gen2 &r2, G
     Gen2 K = (r.z + C).sqr() - (r.t + D);
     Gen2 L = K.sqr();
     Gen2 M = A * p.x;
-    Gen2 N = K * q.y;
-    Gen2 O = -A * q.x;
     a = M + M - (p.y + K).sqr() + r2 + L;
-    b = O + O;
-    c = N + N;
+    b = -(A + A);
+    c = K + K;
     return G2(I, (H - I) * A - (J + J), K, L);
 }
-static Gen12 miller(const G1 &_A, const G2 &_B)
+static const int8_t sixuPlus2NAF[] = {
+    1, 0, 1, 0, 0, -1, 0, 1, 1, 0, 0, 0, -1, 0, 0, 1,
+    1, 0, 0, -1, 0, 0, 0, 0, 0, 1, 0, 0, -1, 0, 0, 1,
+    1, 1, 0, 0, 0, 0, -1, 0, 1, 0, 0, -1, 0, 1, 1, 0,
+    0, 1, 0, 0, -1, 1, 0, 0, -1, 0, 1, 0, 1, 0, 0, 0,
+};
+static void miller_lines(const G2 &_B, std::vector<Gen2> &lines)
 {
-    static const int8_t sixuPlus2NAF[] = {
-        1, 0, 1, 0, 0, -1, 0, 1, 1, 0, 0, 0, -1, 0, 0, 1,
-        1, 0, 0, -1, 0, 0, 0, 0, 0, 1, 0, 0, -1, 0, 0, 1,
-        1, 1, 0, 0, 0, 0, -1, 0, 1, 0, 0, -1, 0, 1, 1, 0,
-        0, 1, 0, 0, -1, 1, 0, 0, -1, 0, 1, 0, 1, 0, 0, 0,
-    };
-
-    static const bigint XI_P2_1_3 = big("21888242871839275220042445260109153167277707414472061641714758635765020556616");
-    static const Gen2 XI_P_1_3(
-        big("10307601595873709700152284273816112264069230130616436755625194854815875713954"),
-        big("21575463638280843010398324269430826099269044274347216827212613867836435027261")
-    );
-    static const Gen2 XI_P_1_2(
-        big("3505843767911556378687030309984248845540243509899259641013678093033130930403"),
-        big("2821565182194536844548159561693502659359617185244120367078079554186484126554")
-    );
-
     Gen2 _1; _1 = 1;
-    G1 A = _A.affine();
-    G2 B = _B; B.affine();
+    G2 B = _B.affine();
     G2 C = -B;
-    G2 P(B.x.conj() * XI_P_1_3, B.y.conj() * XI_P_1_2, _1, _1);
-    G2 Q(B.x * XI_P2_1_3, B.y, _1, _1);
+    G2 P(B.x.conj() * Gen2(XI_P_1_3()[0], XI_P_1_3()[1]), B.y.conj() * Gen2(XI_P_1_2()[0], XI_P_1_2()[1]), _1, _1);
+    G2 Q(B.x * XI_P2_1_3(), B.y, _1, _1);
     G2 R = B;
     Gen2 r2 = B.y.sqr();
     Gen2 a, b, c;
+    lines.clear();
+    for (uint64_t i = 0; i < sizeof(sixuPlus2NAF); i++) {
+        R = line_func_twice(R, a, b, c);
+        lines.push_back(a); lines.push_back(b); lines.push_back(c);
+        if (sixuPlus2NAF[i] == 0) continue;
+        if (sixuPlus2NAF[i] > 0) R = line_func_add(R, B, r2, a, b, c);
+        if (sixuPlus2NAF[i] < 0) R = line_func_add(R, C, r2, a, b, c);
+        lines.push_back(a); lines.push_back(b); lines.push_back(c);
+    }
+    R = line_func_add(R, P, P.y.sqr(), a, b, c);
+    lines.push_back(a); lines.push_back(b); lines.push_back(c);
+    R = line_func_add(R, Q, Q.y.sqr(), a, b, c);
+    lines.push_back(a); lines.push_back(b); lines.push_back(c);
+}
+// multi-miller loop, all pairs are stepped together so that
+// the accumulator is squared only once per iteration
+static Gen12 miller(const std::vector<G1> &A, const std::vector<const Gen2*> &lines)
+{
+    uint64_t count = A.size();
+    uint64_t offset = 0;
     Gen12 ret; ret = 1;
     for (uint64_t i = 0; i < sizeof(sixuPlus2NAF); i++) {
-        R = line_func_twice(A, R, a, b, c);
         if (i > 0) ret = ret.sqr();
-        mul_line(a, b, c, ret);
+        for (uint64_t j = 0; j < count; j++) {
+            const Gen2 *l = &lines[j][offset];
+            mul_line(l[0], l[1] * A[j].x, l[2] * A[j].y, ret);
+        }
+        offset += 3;
         if (sixuPlus2NAF[i] == 0) continue;
-        if (sixuPlus2NAF[i] > 0) R = line_func_add(A, R, B, r2, a, b, c);
-        if (sixuPlus2NAF[i] < 0) R = line_func_add(A, R, C, r2, a, b, c);
-        mul_line(a, b, c, ret);
-    }
-    R = line_func_add(A, R, P, P.y.sqr(), a, b, c);
-    mul_line(a, b, c, ret);
-    R = line_func_add(A, R, Q, Q.y.sqr(), a, b, c);
-    mul_line(a, b, c, ret);
+        for (uint64_t j = 0; j < count; j++) {
+            const Gen2 *l = &lines[j][offset];
+            mul_line(l[0], l[1] * A[j].x, l[2] * A[j].y, ret);
+        }
+        offset += 3;
+    }
+    for (uint64_t k = 0; k < 2; k++) {
+        for (uint64_t j = 0; j < count; j++) {
+            const Gen2 *l = &lines[j][offset];
+            mul_line(l[0], l[1] * A[j].x, l[2] * A[j].y, ret);
+        }
+        offset += 3;
+    }
     return ret;
 }
+// bounded cache of precomputed lines, least recently used entries are replaced
+// verifiers tend to pair against the same twist points over and over
+template<class Gen2, class TwistPoint>
+class LineCache_t {
+private:
+    static constexpr int L = 8;
+    struct entry {
+        bool used = false;
+        uint64_t serial = 0;
+        TwistPoint point;
+        std::vector<Gen2> lines;
+    };
+    uint64_t serial = 0;
+    entry entries[L];
+    static bool equals(const TwistPoint &p1, const TwistPoint &p2) {
+        return p1.x.x == p2.x.x && p1.x.y == p2.x.y && p1.y.x == p2.y.x && p1.y.y == p2.y.y;
+    }
+public:
+    const Gen2 *find(const TwistPoint &point) {
+        for (uint64_t i = 0; i < L; i++) {
+            if (entries[i].used && equals(entries[i].point, point)) {
+                entries[i].serial = ++serial;
+                return entries[i].lines.data();
+            }
+        }
+        return nullptr;
+    }
+    void insert(const TwistPoint &point, std::vector<Gen2> &lines) {
+        if (find(point) != nullptr) return;
+        uint64_t index = 0;
+        for (uint64_t i = 0; i < L; i++) {
+            if (!entries[i].used) { index = i; break; }
+            if (entries[i].serial < entries[index].serial) index = i;
+        }
+        entries[index].used = true;
+        entries[index].serial = ++serial;
+        entries[index].point = point;
+        entries[index].lines.swap(lines);
+    }
+};
+using LineCache = LineCache_t<Gen2, G2>;
 static Gen12 bn256check(const Gen12 &v)
 {
-    static const bigint U = big("4965661367192848881");
-    Gen12 t0 = Gen12(-v.x, v.y) * v.inv();
+    // the bn256 parameter u = 4965661367192848881 in non-adjacent form
+    static const int8_t uNAF[] = {
+        1, 0, 0, 0, 1, 0, 1, 0, 0, -1, 0, 1, 0, 1, 0, -1,
+        0, 0, 1, 0, 1, 0, -1, 0, -1, 0, -1, 0, 1, 0, 0, 0,
+        1, 0, 0, 1, 0, 1, 0, 1, 0, -1, 0, 1, 0, 0, 1, 0,
+        0, 0, 0, 1, 0, 1, 0, 0, 0, 0, -1, 0, 0, 0, 1,
+    };
+
+    // easy part, the only inversion, maps v into the cyclotomic subgroup
+    Gen12 t0 = v.conj() * v.inv();
     Gen12 t1 = t0 * t0.frob2();
+    // hard part, only cyclotomic squarings from here on
     Gen12 t2 = t1.frob2();
-    Gen12 t3 = t1.pow(U);
-    Gen12 t4 = t3.pow(U);
-    Gen12 t5 = t4.pow(U);
+    Gen12 t3 = t1.cyclo_pow(uNAF, sizeof(uNAF));
+    Gen12 t4 = t3.cyclo_pow(uNAF, sizeof(uNAF));
+    Gen12 t5 = t4.cyclo_pow(uNAF, sizeof(uNAF));
     Gen12 t6 = t4.conj();
-    Gen12 t7 = (t5 * t5.frob()).conj().sqr() * (t3 * t4.frob()).conj() * t6;
-    Gen12 t8 = ((t7 * t3.frob().conj() * t6).sqr() * t7 * t4.frob2()).sqr();
-    return (t8 * t1.conj()).sqr() * t8 * t1.frob() * t2 * t2.frob();
+    Gen12 t7 = (t5 * t5.frob()).conj().cyclo_sqr() * (t3 * t4.frob()).conj() * t6;
+    Gen12 t8 = ((t7 * t3.frob().conj() * t6).cyclo_sqr() * t7 * t4.frob2()).cyclo_sqr();
+    return (t8 * t1.conj()).cyclo_sqr() * t8 * t1.frob() * t2 * t2.frob();
 }
 #ifdef NATIVE_CRYPTO
 static G1 bn256add(const G1& p1, const G1& p2);
@@ -2572,16 +3813,217 @@ static G1 bn256add(const G1& p1, const G1& p2)
 {
     return (p1 + p2).affine();
 }
+// reduced lattice basis (a1, -b1), (a2, b2) satisfying a + b * lambda = 0 mod Q, where b2 = a1
+static const uint32_t glv_a1_[2] = { 0x94d213e3, 0x89d32568 };
+static const uint32_t glv_b1_[4] = { 0x7d4f1128, 0x8211bbeb, 0xeeb859fc, 0x6f4d8248 };
+static const uint32_t glv_a2_[4] = { 0x1221250b, 0x0be4e154, 0xeeb859fd, 0x6f4d8248 };
+static const bigint GLV_A1(glv_a1_, 2);
+static const bigint GLV_B1(glv_b1_, 4);
+static const bigint GLV_A2(glv_a2_, 4);
+// scalar multiplication using the GLV endomorphism (x, y) -> (beta * x, y) = lambda * (x, y)
+// the scalar is split as k1 + k2 * lambda with both halves around 128 bits,
+// then each half is processed in width-5 NAF sharing the same doublings
+// only the final result is converted back to affine coordinates
 static G1 bn256scalarmul(const G1& p1, const bigint& e)
 {
-    return (p1 * e).affine();
+    const bigint &Q = Q_();
+    const bigint &BETA = XI_2_P2_2_3(); // the cube root of unity happens to be xi^(2(p^2-1)/3)
+    const bigint &A1 = GLV_A1, &B1 = GLV_B1, &A2 = GLV_A2, &B2 = GLV_A1;
+    static constexpr int W = 5;
+    static constexpr int T = 1 << (W - 2);
+
+    if (p1.is_inf()) return p1;
+    bigint k = e % Q;
+    if (k == 0) { G1 p; p.inf(); return p; }
+
+    // babai rounding, k1 = k - c1 * a1 - c2 * a2 and k2 = c1 * b1 - c2 * b2
+    bigint c1 = (B2 * k + (Q >> 1)) / Q;
+    bigint c2 = (B1 * k + (Q >> 1)) / Q;
+    bigint k1p = k, k1n = c1 * A1 + c2 * A2;
+    bigint k2p = c1 * B1, k2n = c2 * B2;
+    bool neg1 = k1p < k1n, neg2 = k2p < k2n;
+    bigint k1 = neg1 ? k1n - k1p : k1p - k1n;
+    bigint k2 = neg2 ? k2n - k2p : k2p - k2n;
+
+    int8_t naf1[136], naf2[136];
+    uint64_t size1 = wnaf(k1, W, naf1, sizeof(naf1));
+    uint64_t size2 = wnaf(k2, W, naf2, sizeof(naf2));
+
+    // odd multiples p, 3p, ..., (2T-1)p and their images, kept as jacobians
+    // as an affine table would cost an extra inversion, pricier than the additions it saves
+    G1 table1[T], table2[T];
+    G1 p2 = p1.twice();
+    table1[0] = p1;
+    for (int i = 1; i < T; i++) table1[i] = table1[i - 1] + p2;
+    for (int i = 0; i < T; i++) {
+        table2[i] = table1[i];
+        table2[i].x = (BETA * table1[i].x) % G1::P();
+        if (neg1) table1[i] = -table1[i];
+        if (neg2) table2[i] = -table2[i];
+    }
+
+    G1 sum; sum.inf();
+    for (uint64_t i = _max(size1, size2); i > 0; i--) {
+        sum = sum.twice();
+        int d1 = i <= size1 ? naf1[i - 1] : 0;
+        int d2 = i <= size2 ? naf2[i - 1] : 0;
+        if (d1 > 0) sum += table1[d1 / 2];
+        if (d1 < 0) sum += -table1[-d1 / 2];
+        if (d2 > 0) sum += table2[d2 / 2];
+        if (d2 < 0) sum += -table2[-d2 / 2];
+    }
+    return sum.affine();
+}
+// runs the miller loop over a share of the pairs, first computing the
+// lines that were not found in the cache
+static void miller_share(const G1 *points, const G2 *const *twists, const Gen2 **lines,
+    std::vector<Gen2> *computed, uint64_t count, Gen12 *f)
+{
+    for (uint64_t j = 0; j < count; j++) {
+        if (lines[j] != nullptr) continue;
+        miller_lines(*twists[j], computed[j]);
+        lines[j] = computed[j].data();
+    }
+    std::vector<G1> A(points, points + count);
+    std::vector<const Gen2*> L(lines, lines + count);
+    *f = miller(A, L);
+}
+// the number of shares the pairs are split into
+// on linux, pairings of at least PAIRING_MIN_PARALLEL pairs are spread over
+// a few threads, as aggregated proof verifiers send 10-20 pairs at once
+// the partial miller loops multiply to the very same value, regardless of
+// the split, and the final exponentiation is done once over the product
+#if defined(__linux__)
+static constexpr uint64_t PAIRING_MIN_PARALLEL = 4;
+static constexpr uint64_t PAIRING_MAX_THREADS = 4;
+// a pool of persistent threads for the pairing shares, started on first use
+// so that each pairing does not pay for creating threads
+// it runs one batch of shares at a time, like the line cache it serves, the
+// caller runs the first share and then helps with the queued ones
+// if a thread cannot be started the pool keeps the ones that were, and with
+// no threads at all the caller simply runs every share itself
+template<class Gen2, class Gen12, class Point, class TwistPoint>
+class PairingPool_t {
+public:
+    struct share {
+        const Point *points;
+        const TwistPoint *const *twists;
+        const Gen2 **lines;
+        std::vector<Gen2> *computed;
+        uint64_t count;
+        Gen12 *f;
+    };
+private:
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::vector<std::thread> threads;
+    std::vector<share> queue;
+    uint64_t pending = 0; // queued or running shares
+    bool started = false;
+    bool stopping = false;
+    static void run(const share &s) { miller_share(s.points, s.twists, s.lines, s.computed, s.count, s.f); }
+    // takes a queued share, if any, and runs it, the lock is held on entry and exit
+    bool step(std::unique_lock<std::mutex> &lock) {
+        if (queue.empty()) return false;
+        share s = queue.back();
+        queue.pop_back();
+        lock.unlock();
+        run(s);
+        lock.lock();
+        if (--pending == 0) done.notify_all();
+        return true;
+    }
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            while (!stopping && queue.empty()) wake.wait(lock);
+            if (stopping) return;
+            step(lock);
+        }
+    }
+    // thread creation may fail, the threads are reserved up front so that
+    // a started thread is always kept and later joined
+    void start() {
+        started = true;
+        uint64_t cores = std::thread::hardware_concurrency();
+        uint64_t count = _min(cores, PAIRING_MAX_THREADS);
+        if (count < 2) return;
+        try {
+            threads.reserve(count - 1);
+            for (uint64_t t = 0; t < count - 1; t++) threads.push_back(std::thread(&PairingPool_t::work, this));
+        } catch (...) {
+        }
+    }
+public:
+    ~PairingPool_t() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (uint64_t t = 0; t < threads.size(); t++) threads[t].join();
+    }
+    // the number of threads available, the caller included
+    uint64_t size() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!started) start();
+        return threads.size() + 1;
+    }
+    // runs all the shares, returning once they are all done
+    void run(const share *shares, uint64_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (uint64_t k = count; k > 1; k--) queue.push_back(shares[k - 1]);
+        pending += count - 1;
+        if (count > 1 && threads.size() > 0) wake.notify_all();
+        lock.unlock();
+        run(shares[0]);
+        lock.lock();
+        while (step(lock)) {}
+        while (pending > 0) done.wait(lock);
+    }
+};
+using PairingPool = PairingPool_t<Gen2, Gen12, G1, G2>;
+static PairingPool pairing_pool;
+#endif
+static uint64_t pairing_shares(uint64_t pairs)
+{
+#if defined(__linux__)
+    if (pairs < PAIRING_MIN_PARALLEL) return 1;
+    return _max(1, _min(pairing_pool.size(), pairs / 2));
+#else
+    return 1;
+#endif
 }
 static bool bn256pairing(const std::vector<G1> &a, const std::vector<G2> &b, uint64_t count)
 {
-    Gen12 prod; prod = 1;
+    static LineCache cache;
+    std::vector<G1> points;
+    std::vector<const G2*> twists;
+    std::vector<const Gen2*> lines;
     for (uint64_t i = 0; i < count; i++) {
         if (a[i].is_inf() || b[i].is_inf()) continue;
-        prod *= miller(a[i], b[i]);
+        points.push_back(a[i].affine());
+        twists.push_back(&b[i]);
+        lines.push_back(cache.find(b[i]));
+    }
+    uint64_t pairs = points.size();
+    std::vector< std::vector<Gen2> > computed(pairs);
+    uint64_t shares = pairing_shares(pairs);
+    std::vector<Gen12> partials(shares);
+#if defined(__linux__)
+    std::vector<PairingPool::share> list(shares);
+    for (uint64_t k = 0; k < shares; k++) {
+        uint64_t begin = pairs * k / shares, end = pairs * (k + 1) / shares;
+        list[k] = { points.data() + begin, twists.data() + begin, lines.data() + begin, computed.data() + begin, end - begin, &partials[k] };
+    }
+    pairing_pool.run(list.data(), shares);
+#else
+    miller_share(points.data(), twists.data(), lines.data(), computed.data(), pairs, &partials[0]);
+#endif
+    Gen12 prod = partials[0];
+    for (uint64_t k = 1; k < shares; k++) prod = prod * partials[k];
+    for (uint64_t j = 0; j < pairs; j++) {
+        if (computed[j].size() > 0) cache.insert(*twists[j], computed[j]);
     }
     Gen12 value = bn256check(prod);
     return value.is_one();
@@ -2602,10 +4044,6 @@ static uint64_t _throws(dump_nlzint)(uint256_t v, uint8_t *b, uint64_t s)
     }
     return l;
 }
-static uint64_t _throws(dump_nlzint)(uint256_t v)
-{
-    return _handles0(dump_nlzint)(v, nullptr, 0);
-}
 
 // parses a non-leading zeros number from a buffer
 static uint256_t _throws(parse_nlzint)(const uint8_t *&b, uint64_t &s, uint64_t l)
@@ -2669,94 +4107,123 @@ static uint64_t _throws(parse_varlen)(const uint8_t *&b, uint64_t &s, bool &is_l
     is_list = false; return n - 0x80;
 }
 
-// simple rlp structure implemented in C style
-struct rlp {
-    bool is_list;
+// a single pass rlp writer that fills the buffer right-to-left
+// items are therefore written last to first, a list is written by taking
+// the current size as a mark, writing its items and then prepending its
+// header with rlp_list, the result ends up at the end of the buffer
+// if buffer is null it simply accounts for the required size
+struct rlp_writer {
+    uint8_t *b;
+    uint64_t s;
     uint64_t size;
-    union {
-        uint8_t *data;
-        struct rlp *list;
-    };
 };
 
-// releases the memory allocated for the rlp
-static void free_rlp(struct rlp &rlp)
+// writes a byte string item
+static void _throws(rlp_bytes)(struct rlp_writer &w, const uint8_t *data, uint64_t size)
+{
+    if (w.b != nullptr) {
+        if (w.s - w.size < size) _throw(INSUFFICIENT_SPACE);
+        uint8_t *b = &w.b[w.s - w.size - size];
+        for (uint64_t i = 0; i < size; i++) b[i] = data[i];
+    }
+    w.size += size;
+    uint8_t c = size > 0 ? data[0] : 0;
+    w.size += _handles(dump_varlen)(0x80, c, size, w.b, w.s - w.size);
+}
+
+// writes a non-leading zeros number item
+static void _throws(rlp_uint)(struct rlp_writer &w, const uint256_t &v)
+{
+    uint64_t l = _handles(dump_nlzint)(v, w.b, w.s - w.size);
+    uint8_t c = l > 0 ? v.byte(l - 1) : 0;
+    w.size += l;
+    w.size += _handles(dump_varlen)(0x80, c, l, w.b, w.s - w.size);
+}
+
+// writes a 20 bytes address item
+static void _throws(rlp_address)(struct rlp_writer &w, const uint160_t &address)
+{
+    uint8_t buffer[20];
+    uint160_t::to(address, buffer);
+    _handles(rlp_bytes)(w, buffer, 20);
+}
+
+// prepends the header of a list whose items were written since mark
+static void _throws(rlp_list)(struct rlp_writer &w, uint64_t mark)
 {
-    if (rlp.is_list) {
-        for (uint64_t i = 0; i < rlp.size; i++) free_rlp(rlp.list[i]);
-        _delete(rlp.list);
-        rlp.size = 0;
-        rlp.list = nullptr;
-    } else {
-        _delete(rlp.data);
-        rlp.size = 0;
-        rlp.data = nullptr;
-    }
+    w.size += _handles(dump_varlen)(0xc0, 0, w.size - mark, w.b, w.s - w.size);
 }
 
-// writes the rlp into a buffer
+// encodes a log entry as rlp into a buffer, that is [address, [topics], data]
 // if buffer is null simply returns the required size
-static uint64_t _throws(dump_rlp)(const struct rlp &rlp, uint8_t *b, uint64_t s)
+static uint64_t _throws(encode_log)(const uint160_t &address, const uint256_t *topics, uint64_t count, const uint8_t *data, uint64_t data_size, uint8_t *buffer, uint64_t size)
 {
-    uint64_t size = 0;
-    if (rlp.is_list) {
-        uint8_t c = 0;
-        for (uint64_t i = 0; i < rlp.size; i++) {
-            uint64_t j = rlp.size - (i + 1);
-            size += _handles0(dump_rlp)(rlp.list[j], b, s - size);
-        }
-        size += _handles0(dump_varlen)(0xc0, c, size, b, s - size);
-    } else {
-        uint8_t c = rlp.size > 0 ? rlp.data[0] : 0;
-        if (b != nullptr) {
-            if (s < rlp.size) _throw0(INSUFFICIENT_SPACE);
-            for (uint64_t i = 0; i < rlp.size; i++) {
-                uint64_t j = (s - rlp.size) + i;
-                b[j] = rlp.data[i];
-            }
-        }
-        size += rlp.size;
-        size += _handles0(dump_varlen)(0x80, c, size, b, s - size);
-    }
-    return size;
+    struct rlp_writer w = {buffer, size, 0};
+    _handles0(rlp_bytes)(w, data, data_size);
+    uint64_t mark = w.size;
+    for (uint64_t i = count; i > 0; i--) {
+        uint8_t topic[32];
+        uint256_t::to(topics[i - 1], topic);
+        _handles0(rlp_bytes)(w, topic, 32);
+    }
+    _handles0(rlp_list)(w, mark);
+    _handles0(rlp_address)(w, address);
+    _handles0(rlp_list)(w, 0);
+    return w.size;
 }
 
-// parses an rlp from a buffer
-static void _throws(parse_rlp)(const uint8_t *&b, uint64_t &s, struct rlp &rlp)
+// a view of an rlp item borrowed from the buffer it was parsed from
+// data points to the payload, which for a list holds the encoded items,
+// and encoding spans the whole item, header included
+struct rlp_view {
+    bool is_list;
+    const uint8_t *data;
+    uint64_t size;
+    const uint8_t *encoding;
+    uint64_t encoding_size;
+};
+
+// parses an rlp item from a buffer, nothing is allocated or copied
+static void _throws(parse_rlp)(const uint8_t *&b, uint64_t &s, struct rlp_view &rlp)
 {
+    const uint8_t *encoding = b;
     bool is_list = false;
     uint64_t l = _handles(parse_varlen)(b, s, is_list);
     if (l > s) _throw(INVALID_ENCODING);
-    const uint8_t *_b = b;
-    uint64_t _s = l;
+    rlp.is_list = is_list;
+    rlp.data = b;
+    rlp.size = l;
+    rlp.encoding = encoding;
+    rlp.encoding_size = (b - encoding) + l;
     b += l; s -= l;
-    if (is_list) {
-        uint64_t size = 0;
-        struct rlp *list = nullptr;
-        while (_s > 0) {
-            _try({
-                struct rlp *new_list = _new<struct rlp>(size + 1);
-                for (uint64_t i = 0; i < size; i++) new_list[i] = list[i];
-                _delete(list);
-                list = new_list;
-                _catches(parse_rlp)(_b, _s, list[size]);
-            }, Error e, {
-                for (uint64_t i = 0; i < size; i++) free_rlp(list[i]);
-                _delete(list);
-                _throw(e);
-            })
-            size++;
-        }
-        rlp.is_list = is_list;
-        rlp.size = size;
-        rlp.list = list;
-    } else {
-        uint64_t size = _s;
-        uint8_t *data = _new<uint8_t>(size);
-        for (uint64_t i = 0; i < size; i++) data[i] = _b[i];
-        rlp.is_list = is_list;
-        rlp.size = size;
-        rlp.data = data;
+}
+
+// lazy iterator over the items of a list view
+// items are parsed on demand by next_rlp while there are bytes left
+struct rlp_iter {
+    const uint8_t *b;
+    uint64_t s;
+};
+static inline struct rlp_iter iter_rlp(const struct rlp_view &rlp)
+{
+    assert(rlp.is_list);
+    return {rlp.data, rlp.size};
+}
+static void _throws(next_rlp)(struct rlp_iter &iter, struct rlp_view &item)
+{
+    assert(iter.s > 0);
+    _handles(parse_rlp)(iter.b, iter.s, item);
+}
+
+// validates a list view and all of its nested items
+static void _throws(scan_rlp)(const struct rlp_view &rlp)
+{
+    assert(rlp.is_list);
+    struct rlp_iter iter = iter_rlp(rlp);
+    while (iter.s > 0) {
+        struct rlp_view item;
+        _handles(next_rlp)(iter, item);
+        if (item.is_list) _handles(scan_rlp)(item);
     }
 }
 
@@ -2819,103 +4286,82 @@ struct txn {
     uint256_t v;
     uint256_t r;
     uint256_t s;
+    const uint8_t *raw; // the encoding it was decoded from, if any
+    uint64_t fields_offset; // the span of the first six items within raw
+    uint64_t fields_size;
 };
 
 // encodes a transaction as rlp into a buffer
+// if buffer is null simply returns the required size
 static uint64_t _throws(encode_txn)(const struct txn &txn, uint8_t *buffer, uint64_t size)
 {
-    uint64_t result;
-    struct rlp rlp;
-    rlp.is_list = true;
-    rlp.size = txn.is_signed ? 9 : 6;
-    rlp.list = _new<struct rlp>(rlp.size);
-    for (uint64_t i = 0; i < rlp.size; i++) {
-        rlp.list[i].is_list = false;
-        rlp.list[i].size = 0;
-        rlp.list[i].data = nullptr;
+    struct rlp_writer w = {buffer, size, 0};
+    if (txn.is_signed) {
+        _handles0(rlp_uint)(w, txn.s);
+        _handles0(rlp_uint)(w, txn.r);
+        _handles0(rlp_uint)(w, txn.v);
+    }
+    _handles0(rlp_bytes)(w, txn.data, txn.data_size);
+    _handles0(rlp_uint)(w, txn.value);
+    if (txn.has_to) {
+        _handles0(rlp_address)(w, txn.to);
+    } else {
+        _handles0(rlp_bytes)(w, nullptr, 0);
     }
-    _try({
-        rlp.list[0].size = _catches(dump_nlzint)(txn.nonce);
-        rlp.list[1].size = _catches(dump_nlzint)(txn.gasprice);
-        rlp.list[2].size = _catches(dump_nlzint)(txn.gaslimit);
-        rlp.list[3].size = txn.has_to ? 20 : 0;
-        rlp.list[4].size = _catches(dump_nlzint)(txn.value);
-        rlp.list[5].size = txn.data_size;
-        if (txn.is_signed) {
-            rlp.list[6].size = _catches(dump_nlzint)(txn.v);
-            rlp.list[7].size = _catches(dump_nlzint)(txn.r);
-            rlp.list[8].size = _catches(dump_nlzint)(txn.s);
-        }
-        for (uint64_t i = 0; i < rlp.size; i++) {
-            if (rlp.list[i].size > 0) {
-                rlp.list[i].data = _new<uint8_t>(rlp.list[i].size);
-            }
-        }
-        _catches(dump_nlzint)(txn.nonce, rlp.list[0].data, rlp.list[0].size);
-        _catches(dump_nlzint)(txn.gasprice, rlp.list[1].data, rlp.list[1].size);
-        _catches(dump_nlzint)(txn.gaslimit, rlp.list[2].data, rlp.list[2].size);
-        if (txn.has_to) {
-            uint256_t::to(txn.to, rlp.list[3].data, rlp.list[3].size);
-        }
-        _catches(dump_nlzint)(txn.value, rlp.list[4].data, rlp.list[4].size);
-        for (uint64_t i = 0; i < txn.data_size; i++) rlp.list[5].data[i] = txn.data[i];
-        if (txn.is_signed) {
-            _catches(dump_nlzint)(txn.v, rlp.list[6].data, rlp.list[6].size);
-            _catches(dump_nlzint)(txn.r, rlp.list[7].data, rlp.list[7].size);
-            _catches(dump_nlzint)(txn.s, rlp.list[8].data, rlp.list[8].size);
-        }
-        result = _catches(dump_rlp)(rlp, buffer, size);
-        free_rlp(rlp);
-    }, Error e, {
-        free_rlp(rlp);
-        _throw0(e);
-    })
-    return result;
-}
-static uint64_t _throws(encode_txn)(const struct txn &txn)
-{
-    return _handles0(encode_txn)(txn, nullptr, 0);
+    _handles0(rlp_uint)(w, txn.gaslimit);
+    _handles0(rlp_uint)(w, txn.gasprice);
+    _handles0(rlp_uint)(w, txn.nonce);
+    _handles0(rlp_list)(w, 0);
+    return w.size;
 }
 
 // decodes a transaction as rlp from a buffer
+// the items are views into the buffer, only the data gets copied
 static void _throws(decode_txn)(const uint8_t *buffer, uint64_t size, struct txn &txn)
 {
-    struct rlp rlp = {false, 0, {nullptr}};
+    const uint8_t *raw = buffer;
+    struct rlp_view rlp;
     _handles(parse_rlp)(buffer, size, rlp);
-    txn.data = nullptr;
-    _try({
-        if (size > 0) _trythrow(INVALID_TRANSACTION);
-        if (rlp.size != 6 && rlp.size != 9) _trythrow(INVALID_TRANSACTION);
-        if (!rlp.is_list) _trythrow(INVALID_TRANSACTION);
-        bool invalid = false;
-        for (uint64_t i = 0; i < rlp.size; i++) {
-            if (rlp.list[i].is_list) { invalid = true; break; }
-        }
-        if (invalid) _trythrow(INVALID_TRANSACTION);
-        txn.nonce = _catches(parse_nlzint)(rlp.list[0].data, rlp.list[0].size);
-        txn.gasprice = _catches(parse_nlzint)(rlp.list[1].data, rlp.list[1].size);
-        txn.gaslimit = _catches(parse_nlzint)(rlp.list[2].data, rlp.list[2].size);
-        txn.has_to = rlp.list[3].size > 0;
-        if (txn.has_to) {
-            if (rlp.list[3].size != 20) _trythrow(INVALID_TRANSACTION);
-            txn.to = uint160_t::from(rlp.list[3].data, rlp.list[3].size);
-        }
-        txn.value = _catches(parse_nlzint)(rlp.list[4].data, rlp.list[4].size);
-        txn.data_size = rlp.list[5].size;
-        txn.data = _new<uint8_t>(txn.data_size);
-        for (uint64_t i = 0; i < txn.data_size; i++) txn.data[i] = rlp.list[5].data[i];
-        txn.is_signed = rlp.size > 6;
-        if (txn.is_signed) {
-            txn.v = _catches(parse_nlzint)(rlp.list[6].data, rlp.list[6].size);
-            txn.r = _catches(parse_nlzint)(rlp.list[7].data, rlp.list[7].size);
-            txn.s = _catches(parse_nlzint)(rlp.list[8].data, rlp.list[8].size);
+    struct rlp_view list[9];
+    uint64_t count = 0;
+    if (rlp.is_list) {
+        struct rlp_iter iter = iter_rlp(rlp);
+        while (iter.s > 0) {
+            struct rlp_view item;
+            _handles(next_rlp)(iter, item);
+            if (item.is_list) _handles(scan_rlp)(item);
+            if (count < 9) list[count] = item;
+            count++;
         }
-    }, Error e, {
-        _delete(txn.data);
-        free_rlp(rlp);
-        _throw(e);
-    })
-    free_rlp(rlp);
+    }
+    txn.data = nullptr;
+    if (size > 0) _throw(INVALID_TRANSACTION);
+    if (!rlp.is_list) _throw(INVALID_TRANSACTION);
+    if (count != 6 && count != 9) _throw(INVALID_TRANSACTION);
+    for (uint64_t i = 0; i < count; i++) {
+        if (list[i].is_list) _throw(INVALID_TRANSACTION);
+    }
+    txn.nonce = _handles(parse_nlzint)(list[0].data, list[0].size);
+    txn.gasprice = _handles(parse_nlzint)(list[1].data, list[1].size);
+    txn.gaslimit = _handles(parse_nlzint)(list[2].data, list[2].size);
+    txn.has_to = list[3].size > 0;
+    if (txn.has_to) {
+        if (list[3].size != 20) _throw(INVALID_TRANSACTION);
+        txn.to = uint160_t::from(list[3].data, list[3].size);
+    }
+    txn.value = _handles(parse_nlzint)(list[4].data, list[4].size);
+    txn.is_signed = count > 6;
+    if (txn.is_signed) {
+        txn.v = _handles(parse_nlzint)(list[6].data, list[6].size);
+        txn.r = _handles(parse_nlzint)(list[7].data, list[7].size);
+        txn.s = _handles(parse_nlzint)(list[8].data, list[8].size);
+    }
+    txn.data_size = list[5].size;
+    txn.data = _new<uint8_t>(txn.data_size);
+    for (uint64_t i = 0; i < txn.data_size; i++) txn.data[i] = list[5].data[i];
+    txn.raw = raw;
+    txn.fields_offset = list[0].encoding - raw;
+    txn.fields_size = (list[5].encoding + list[5].encoding_size) - list[0].encoding;
 }
 
 // verifies is transaction is signed and its parameters v, s
@@ -2935,6 +4381,32 @@ static void _throws(verify_txn)(Release release, struct txn &txn)
 }
 
 // calculates the sha3 hash for the signed transaction without its signature
+// when the transaction was decoded from a raw encoding, the first six items
+// are streamed from there, only the list header and the eip-155 suffix are
+// encoded on the stack, and nothing is allocated
+static uint256_t _throws(hash_raw_txn)(const struct txn &txn, bool eip155)
+{
+    const uint64_t S = 32 + 2;
+    uint8_t suffix[S];
+    uint64_t suffix_size = 0;
+    if (eip155) {
+        suffix[S - 1] = 0x80;
+        suffix[S - 2] = 0x80;
+        suffix_size = 2;
+        uint64_t l = _handles0(dump_nlzint)(CHAIN_ID, suffix, S - suffix_size);
+        uint8_t c = l > 0 ? suffix[S - suffix_size - l] : 0;
+        suffix_size += l;
+        suffix_size += _handles0(dump_varlen)(0x80, c, l, suffix, S - suffix_size);
+    }
+    const uint64_t H = 1 + 8;
+    uint8_t header[H];
+    uint64_t header_size = _handles0(dump_varlen)(0xc0, 0, txn.fields_size + suffix_size, header, H);
+    Keccak256 keccak;
+    keccak.absorb(&header[H - header_size], header_size);
+    keccak.absorb(&txn.raw[txn.fields_offset], txn.fields_size);
+    keccak.absorb(&suffix[S - suffix_size], suffix_size);
+    return keccak.finish();
+}
 static uint256_t _throws(hash_txn)(struct txn &txn)
 {
     assert(txn.is_signed);
@@ -2942,14 +4414,20 @@ static uint256_t _throws(hash_txn)(struct txn &txn)
     uint256_t v = txn.v;
     uint256_t r = txn.r;
     uint256_t s = txn.s;
+    if (txn.raw != nullptr) {
+        uint256_t h = _handles0(hash_raw_txn)(txn, v > 28);
+        txn.v = v > 28 ? v - (8 + 2 * CHAIN_ID) : v;
+        assert(txn.v == 27 || txn.v == 28);
+        return h;
+    }
     txn.is_signed = v > 28;
     txn.v = CHAIN_ID;
     txn.r = 0;
     txn.s = 0;
-    uint64_t unsigned_size = _handles0(encode_txn)(txn);
-    local<uint8_t> unsigned_buffer_l(unsigned_size); uint8_t *unsigned_buffer = unsigned_buffer_l.data;
-    _handles0(encode_txn)(txn, unsigned_buffer, unsigned_size);
-    uint256_t h = sha3(unsigned_buffer, unsigned_size);
+    uint64_t bound = txn.data_size + 9 * (1 + 32) + 2 * (1 + 8);
+    local<uint8_t> unsigned_buffer_l(bound); uint8_t *unsigned_buffer = unsigned_buffer_l.data;
+    uint64_t unsigned_size = _handles0(encode_txn)(txn, unsigned_buffer, bound);
+    uint256_t h = sha3(&unsigned_buffer[bound - unsigned_size], unsigned_size);
     txn.is_signed = true;
     txn.v = v > 28 ? v - (8 + 2 * CHAIN_ID) : v;
     txn.r = r;
@@ -2958,60 +4436,184 @@ static uint256_t _throws(hash_txn)(struct txn &txn)
     return h;
 }
 
+// a bounded cache from signing hash and signature to the recovered sender
+// so that resubmitted transactions do not pay for recovery again
+// it is set associative with round-robin replacement within a set
+// each entry carries a sequence number that is odd while being written,
+// readers treat a changing or odd sequence as a miss and writers skip busy
+// entries, therefore the cache can be shared among threads without locks
+// the words of an entry are atomics accessed relaxed, ordered by the
+// sequence, so that readers racing a writer are well defined, they are
+// trivially constructed so that a static cache is zero initialized
+template<int SETS, int WAYS>
+class SenderCache_t {
+private:
+    static constexpr int K = 3 * 4 + 1;
+    struct entry {
+        std::atomic<uint32_t> seq;
+        std::atomic<uint64_t> key[K];
+        std::atomic<uint64_t> sender[3];
+    };
+    struct set {
+        std::atomic<uint32_t> next;
+        entry ways[WAYS];
+    };
+    set sets[SETS];
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _misses;
+    std::atomic<uint64_t> _inserts;
+    std::atomic<uint64_t> _evictions;
+    std::atomic<uint64_t> _collisions;
+    static inline uint64_t pair(uint32_t lo, uint32_t hi) { return (uint64_t)hi << 32 | lo; }
+    static void pack(const uint256_t &h, const uint256_t &v, const uint256_t &r, const uint256_t &s, uint64_t *key) {
+        for (int i = 0; i < 4; i++) {
+            key[i] = pair(h.word(2*i), h.word(2*i+1));
+            key[4 + i] = pair(r.word(2*i), r.word(2*i+1));
+            key[8 + i] = pair(s.word(2*i), s.word(2*i+1));
+        }
+        key[12] = pair(v.word(0), v.word(1));
+    }
+public:
+    struct stats { uint64_t hits, misses, inserts, evictions, collisions; };
+    bool lookup(const uint256_t &h, const uint256_t &v, const uint256_t &r, const uint256_t &s, uint160_t &sender) {
+        uint64_t key[K];
+        pack(h, v, r, s, key);
+        set &set = sets[(key[0] ^ key[4]) % SETS];
+        for (int w = 0; w < WAYS; w++) {
+            entry &entry = set.ways[w];
+            uint32_t seq = entry.seq.load(std::memory_order_acquire);
+            if (seq == 0 || (seq & 1) > 0) continue;
+            bool match = true;
+            for (int i = 0; i < K; i++) match &= entry.key[i].load(std::memory_order_relaxed) == key[i];
+            uint64_t words[3];
+            for (int i = 0; i < 3; i++) words[i] = entry.sender[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.seq.load(std::memory_order_relaxed) != seq) continue;
+            if (!match) continue;
+            for (int i = 0; i < 5; i++) sender.setword(i, (uint32_t)(words[i / 2] >> 32 * (i % 2)));
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        _misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    void insert(const uint256_t &h, const uint256_t &v, const uint256_t &r, const uint256_t &s, const uint160_t &sender) {
+        uint64_t key[K];
+        pack(h, v, r, s, key);
+        set &set = sets[(key[0] ^ key[4]) % SETS];
+        entry &entry = set.ways[set.next.fetch_add(1, std::memory_order_relaxed) % WAYS];
+        uint32_t seq = entry.seq.load(std::memory_order_relaxed);
+        if ((seq & 1) > 0 || !entry.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+            _collisions.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < K; i++) entry.key[i].store(key[i], std::memory_order_relaxed);
+        for (int i = 0; i < 3; i++) entry.sender[i].store(pair(sender.word(2*i), 2*i+1 < 5 ? sender.word(2*i+1) : 0), std::memory_order_relaxed);
+        entry.seq.store(seq + 2, std::memory_order_release);
+        if (seq > 0) _evictions.fetch_add(1, std::memory_order_relaxed);
+        _inserts.fetch_add(1, std::memory_order_relaxed);
+    }
+    stats get_stats() const {
+        return {
+            _hits.load(std::memory_order_relaxed),
+            _misses.load(std::memory_order_relaxed),
+            _inserts.load(std::memory_order_relaxed),
+            _evictions.load(std::memory_order_relaxed),
+            _collisions.load(std::memory_order_relaxed),
+        };
+    }
+};
+using SenderCache = SenderCache_t<256, 4>;
+
+static SenderCache sender_cache;
+
+// hashes and recovers the senders of many transactions at once
+// transactions must have passed verify_txn, which the callers run
+// the signature recovery work is shared across the batch, see ecrecover
+// senders found in the sender cache are not recovered again
+// senders are only valid where results report NONE
+static void recover_senders(Release release, struct txn *txns, uint64_t count, uint160_t *senders, Error *results)
+{
+    std::vector<uint64_t> index;
+    std::vector<uint256_t> h, v, r, s;
+    for (uint64_t i = 0; i < count; i++) {
+        results[i] = NONE;
+        senders[i] = 0;
+        _try({
+            uint256_t _h = _catches(hash_txn)(txns[i]);
+            const struct txn &txn = txns[i];
+            if (!valid_signature(txn.v, txn.r, txn.s)) _trythrow(INVALID_SIGNATURE);
+            if (!sender_cache.lookup(_h, txn.v, txn.r, txn.s, senders[i])) {
+                index.push_back(i);
+                h.push_back(_h);
+                v.push_back(txn.v);
+                r.push_back(txn.r);
+                s.push_back(txn.s);
+            }
+        }, Error e, {
+            results[i] = e;
+        })
+    }
+    uint64_t size = index.size();
+    if (size == 0) return;
+    std::vector<G0> points(size);
+    ecrecover(&h[0], &v[0], &r[0], &s[0], size, &points[0]);
+    // public keys are hashed together, see the multi-buffer sha3
+    local<uint8_t> buffer_l(64 * size); uint8_t *buffer = buffer_l.data;
+    std::vector<const uint8_t*> keys;
+    std::vector<uint64_t> sizes, found;
+    for (uint64_t j = 0; j < size; j++) {
+        uint64_t i = index[j];
+        if (points[j].is_inf()) { results[i] = INVALID_SIGNATURE; continue; }
+        uint8_t *key = &buffer[64 * j];
+        bigint::to(points[j].x, &key[0], 32);
+        bigint::to(points[j].y, &key[32], 32);
+        keys.push_back(key);
+        sizes.push_back(64);
+        found.push_back(j);
+    }
+    if (found.size() == 0) return;
+    std::vector<uint256_t> hashes(found.size());
+    sha3(&keys[0], &sizes[0], found.size(), &hashes[0]);
+    for (uint64_t l = 0; l < found.size(); l++) {
+        uint64_t j = found[l];
+        uint64_t i = index[j];
+        senders[i] = (uint160_t)hashes[l];
+        sender_cache.insert(h[j], v[j], r[j], s[j], senders[i]);
+    }
+}
+
 // ** contract id **
 
 // encodes a contract id as rlp into a buffer
 // used to calculate an address for a new contract which is a hash of
 // an address and a nonce in rpl form
+// if buffer is null simply returns the required size
 static uint64_t _throws(encode_cid)(const uint256_t &from, const uint256_t &nonce, uint8_t *buffer, uint64_t size)
 {
-    uint64_t result;
-    struct rlp rlp;
-    rlp.is_list = true;
-    rlp.size = 2;
-    rlp.list = _new<struct rlp>(rlp.size);
-    for (uint64_t i = 0; i < rlp.size; i++) {
-        rlp.list[i].is_list = false;
-        rlp.list[i].size = 0;
-        rlp.list[i].data = nullptr;
-    }
-    _try({
-        rlp.list[0].size = _catches(dump_nlzint)(from);
-        rlp.list[1].size = _catches(dump_nlzint)(nonce);
-        for (uint64_t i = 0; i < rlp.size; i++) {
-            if (rlp.list[i].size > 0) {
-                rlp.list[i].data = _new<uint8_t>(rlp.list[i].size);
-            }
-        }
-        _catches(dump_nlzint)(from, rlp.list[0].data, rlp.list[0].size);
-        _catches(dump_nlzint)(nonce, rlp.list[1].data, rlp.list[1].size);
-        result = _catches(dump_rlp)(rlp, buffer, size);
-        free_rlp(rlp);
-    }, Error e, {
-        free_rlp(rlp);
-        _throw0(e);
-    })
-    return result;
-}
-static uint64_t _throws(encode_cid)(const uint256_t &from, const uint256_t &nonce)
-{
-    return _handles0(encode_cid)(from, nonce, nullptr, 0);
+    struct rlp_writer w = {buffer, size, 0};
+    _handles0(rlp_uint)(w, nonce);
+    _handles0(rlp_uint)(w, from);
+    _handles0(rlp_list)(w, 0);
+    return w.size;
 }
 
 // generates a contract address given caller and nonce (CREATE method)
+// the contract id fits on the stack so that nothing is allocated
 static uint160_t _throws(gen_contract_address)(const uint160_t &from, const uint256_t &nonce)
 {
-    uint64_t size = _handles0(encode_cid)((uint256_t)from, nonce);
-    local<uint8_t> buffer_l(size); uint8_t *buffer = buffer_l.data;
-    _handles0(encode_cid)((uint256_t)from, nonce, buffer, size);
-    return (uint160_t)sha3(buffer, size);
+    const uint64_t S = 2 + 2 * (1 + 32);
+    uint8_t buffer[S];
+    uint64_t size = _handles0(encode_cid)((uint256_t)from, nonce, buffer, S);
+    return (uint160_t)sha3(&buffer[S - size], size);
 }
 
 // generates a contract address given caller, salt, and code hash (CREATE2 method)
 static uint160_t gen_contract_address(const uint160_t &from, const uint256_t &salt, const uint256_t &hash)
 {
-    uint64_t size = 1 + 20 + 32 + 32;
-    local<uint8_t> buffer_l(size); uint8_t *buffer = buffer_l.data;
+    const uint64_t size = 1 + 20 + 32 + 32;
+    uint8_t buffer[size];
     uint64_t offset = 0;
     buffer[offset] = 0xff; offset += 1;
     uint160_t::to(from, &buffer[offset]); offset += 20;
@@ -3201,8 +4803,8 @@ static const uint16_t CODE_SIZE = 24576;
 // max frame stack
 static const uint16_t STACK_SIZE = 1024;
 
-// handy constant identifying empty bytecode
-static const uint256_t EMPTY_CODEHASH = sha3(nullptr, 0);
+// handy constant identifying empty bytecode, sha3(nullptr, 0)
+static constexpr uint256_t EMPTY_CODEHASH = u256(0xc5d2460186f7233c, 0x927e7db2dcc703c0, 0xe500b653ca82273b, 0x7bfad8045d85a470);
 
 // the list of opcodes
 enum Opcode : uint8_t {
@@ -3626,9 +5228,20 @@ static const char *prenames[BLAKE2F+1] = {
 };
 #endif // NDEBUG
 
-// sets of supported opcodes by release (encoded as 256-bit words)
-static const uint256_t _1 = (uint256_t)1;
-static const uint256_t is_frontier = 0
+// compile-time set of opcodes (or precompiled contracts), one bit each
+// kept as four 64-bit words so that membership is a single shift and mask
+struct opset {
+    uint64_t w[4];
+    constexpr bool has(uint8_t i) const { return ((w[i >> 6] >> (i & 63)) & 1) > 0; }
+};
+struct opbit {};
+static constexpr opset operator|(const opset &a, const opset &b) { return opset{{ a.w[0] | b.w[0], a.w[1] | b.w[1], a.w[2] | b.w[2], a.w[3] | b.w[3] }}; }
+static constexpr opset operator<<(opbit, int i) { return opset{{ i >> 6 == 0 ? 1ull << (i & 63) : 0, i >> 6 == 1 ? 1ull << (i & 63) : 0, i >> 6 == 2 ? 1ull << (i & 63) : 0, i >> 6 == 3 ? 1ull << (i & 63) : 0 }}; }
+static constexpr opset _0 = {{ 0, 0, 0, 0 }};
+static constexpr opbit _1 = {};
+
+// sets of supported opcodes by release
+static constexpr opset is_frontier = _0
     | _1 << STOP | _1 << ADD | _1 << MUL | _1 << SUB | _1 << DIV | _1 << SDIV | _1 << MOD | _1 << SMOD
     | _1 << ADDMOD | _1 << MULMOD | _1 << EXP | _1 << SIGNEXTEND
     | _1 << LT | _1 << GT | _1 << SLT | _1 << SGT | _1 << EQ | _1 << ISZERO | _1 << AND | _1 << OR
@@ -3650,28 +5263,28 @@ static const uint256_t is_frontier = 0
     | _1 << LOG0 | _1 << LOG1 | _1 << LOG2 | _1 << LOG3 | _1 << LOG4
     | _1 << CREATE | _1 << CALL | _1 << CALLCODE | _1 << RETURN
     | _1 << SELFDESTRUCT;
-static const uint256_t is_homestead = is_frontier
+static constexpr opset is_homestead = is_frontier
     | _1 << DELEGATECALL;
-static const uint256_t is_tangerine_whistle = is_homestead;
-static const uint256_t is_spurious_dragon = is_tangerine_whistle;
-static const uint256_t is_byzantium = is_spurious_dragon
+static constexpr opset is_tangerine_whistle = is_homestead;
+static constexpr opset is_spurious_dragon = is_tangerine_whistle;
+static constexpr opset is_byzantium = is_spurious_dragon
     | _1 << STATICCALL
     | _1 << RETURNDATASIZE
     | _1 << RETURNDATACOPY
     | _1 << REVERT;
-static const uint256_t is_constantinople = is_byzantium
+static constexpr opset is_constantinople = is_byzantium
     | _1 << SHL
     | _1 << SHR
     | _1 << SAR
     | _1 << EXTCODEHASH
     | _1 << CREATE2;
-static const uint256_t is_petersburg = is_constantinople;
-static const uint256_t is_istanbul = is_petersburg
+static constexpr opset is_petersburg = is_constantinople;
+static constexpr opset is_istanbul = is_petersburg
     | _1 << CHAINID
     | _1 << SELFBALANCE;
 
 // this table is used to check if opcode is available for a given release
-static const uint256_t is[ISTANBUL+1] = {
+static constexpr opset is[ISTANBUL+1] = {
     is_frontier,
     is_homestead,
     is_tangerine_whistle,
@@ -3682,27 +5295,27 @@ static const uint256_t is[ISTANBUL+1] = {
     is_istanbul,
 };
 
-// sets of supported precompiled contracts by release (encoded as 256-bit words)
-static uint256_t pre_frontier = 0;
-static uint256_t pre_homestead = pre_frontier
-    | 1 << ECRECOVER
-    | 1 << SHA256
-    | 1 << RIPEMD160
-    | 1 << DATACOPY;
-static uint256_t pre_tangerine_whistle = pre_homestead;
-static uint256_t pre_spurious_dragon = pre_tangerine_whistle;
-static uint256_t pre_byzantium = pre_spurious_dragon
-    | 1 << BIGMODEXP
-    | 1 << BN256ADD
-    | 1 << BN256SCALARMUL
-    | 1 << BN256PAIRING;
-static uint256_t pre_constantinople = pre_byzantium;
-static uint256_t pre_petersburg = pre_constantinople;
-static uint256_t pre_istanbul = pre_petersburg
-    | 1 << BLAKE2F;
+// sets of supported precompiled contracts by release
+static constexpr opset pre_frontier = _0;
+static constexpr opset pre_homestead = pre_frontier
+    | _1 << ECRECOVER
+    | _1 << SHA256
+    | _1 << RIPEMD160
+    | _1 << DATACOPY;
+static constexpr opset pre_tangerine_whistle = pre_homestead;
+static constexpr opset pre_spurious_dragon = pre_tangerine_whistle;
+static constexpr opset pre_byzantium = pre_spurious_dragon
+    | _1 << BIGMODEXP
+    | _1 << BN256ADD
+    | _1 << BN256SCALARMUL
+    | _1 << BN256PAIRING;
+static constexpr opset pre_constantinople = pre_byzantium;
+static constexpr opset pre_petersburg = pre_constantinople;
+static constexpr opset pre_istanbul = pre_petersburg
+    | _1 << BLAKE2F;
 
 // this table is used to check if precompiled contract is available for a given release
-static const uint256_t pre[ISTANBUL+1] = {
+static constexpr opset pre[ISTANBUL+1] = {
     pre_frontier,
     pre_homestead,
     pre_tangerine_whistle,
@@ -3713,21 +5326,21 @@ static const uint256_t pre[ISTANBUL+1] = {
     pre_istanbul,
 };
 
-// some useful sets of opcodes checked by the interpreter (encoded as 256-bit words)
-static const uint256_t is_halts = 0
+// some useful sets of opcodes checked by the interpreter
+static constexpr opset is_halts = _0
     | _1 << STOP
     | _1 << RETURN
     | _1 << SELFDESTRUCT;
-static const uint256_t is_jumps = 0
+static constexpr opset is_jumps = _0
     | _1 << JUMP | _1 << JUMPI;
-static const uint256_t is_writes = 0
+static constexpr opset is_writes = _0
     | _1 << SSTORE
     | _1 << LOG0 | _1 << LOG1 | _1 << LOG2 | _1 << LOG3 | _1 << LOG4
     | _1 << CREATE | _1 << CREATE2
     | _1 << SELFDESTRUCT;
-static const uint256_t is_reverts = 0
+static constexpr opset is_reverts = _0
     | _1 << REVERT;
-static const uint256_t is_returns = 0
+static constexpr opset is_returns = _0
     | _1 << CREATE | _1 << CREATE2
     | _1 << CALL | _1 << CALLCODE | _1 << DELEGATECALL | _1 << STATICCALL
     | _1 << REVERT;
@@ -4399,6 +6012,28 @@ public:
         if (size > 0) mark(offset + size);
         for (uint64_t i = 0; i < size; i++) buffer[i] = get(offset+i);
     }
+    // absorbs a memory range into a hash straight from the pages
+    // pages never written are absorbed as zeros
+    void absorb(Keccak256 &keccak, uint64_t offset, uint64_t size) {
+        static const uint8_t zeros[256] = {0};
+        assert(offset + size >= offset);
+        if (size > 0) mark(offset + size);
+        while (size > 0) {
+            uint64_t page_index = offset / P;
+            uint64_t byte_index = offset % P;
+            uint64_t n = P - byte_index;
+            if (n > size) n = size;
+            if (page_index < page_count && pages[page_index] != nullptr) {
+                keccak.absorb(&pages[page_index][byte_index], n);
+            } else {
+                for (uint64_t i = 0; i < n; i += sizeof(zeros)) {
+                    keccak.absorb(zeros, n - i < sizeof(zeros) ? n - i : sizeof(zeros));
+                }
+            }
+            offset += n;
+            size -= n;
+        }
+    }
     // burns memory from a buffer
     void burn(uint64_t offset, const uint8_t *buffer, uint64_t size) {
         burn(offset, size, buffer, size);
@@ -4413,6 +6048,93 @@ public:
     }
 };
 
+// a bounded memo of the SHA3 opcode over short inputs, as mapping access
+// in solidity hashes the same key and slot pairs over and over, within a
+// transaction and across transactions
+// it is set associative with round-robin replacement within a set, the
+// set is picked by a cheap hash of the input which is then compared in full
+// entries are tagged with a generation so that the whole cache is dropped
+// at once when its lifetime is a single transaction
+// it is off unless a lifetime is set and it is used by the interpreter
+// alone, therefore it is not shared among threads
+// the contract never sets a lifetime, so it is left out of that build
+#ifndef NATIVE_CRYPTO
+template<int SETS, int WAYS>
+class Sha3Cache_t {
+public:
+    enum Lifetime : uint8_t { OFF = 0, TRANSACTION, GLOBAL };
+    static constexpr uint64_t MAX = 64; // largest input cached
+    struct stats { uint64_t hits, misses, inserts, evictions; };
+private:
+    static constexpr int W = MAX / 8;
+    struct entry {
+        uint64_t generation;
+        uint64_t size;
+        uint64_t input[W];
+        uint32_t hash[8];
+    };
+    struct set {
+        uint64_t next;
+        entry ways[WAYS];
+    };
+    set sets[SETS];
+    Lifetime lifetime = OFF;
+    uint64_t generation = 1;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+    uint64_t _inserts = 0;
+    uint64_t _evictions = 0;
+    // loads the input as zero padded words and hashes them
+    static uint64_t pack(const uint8_t *buffer, uint64_t size, uint64_t *input) {
+        uint8_t padded[MAX];
+        for (uint64_t i = 0; i < size; i++) padded[i] = buffer[i];
+        for (uint64_t i = size; i < MAX; i++) padded[i] = 0;
+        uint64_t h = size;
+        for (int i = 0; i < W; i++) {
+            input[i] = b2w64le(&padded[8 * i]);
+            h = (h ^ input[i]) * 0x9e3779b97f4a7c15L;
+        }
+        return h ^ (h >> 32);
+    }
+public:
+    void set_lifetime(Lifetime _lifetime) { lifetime = _lifetime; generation++; }
+    inline bool enabled(uint64_t size) const { return lifetime != OFF && size <= MAX; }
+    // drops the entries of the previous transaction, if so configured
+    void begin_transaction() { if (lifetime == TRANSACTION) generation++; }
+    bool lookup(const uint8_t *buffer, uint64_t size, uint256_t &hash) {
+        uint64_t input[W];
+        set &set = sets[pack(buffer, size, input) % SETS];
+        for (int w = 0; w < WAYS; w++) {
+            entry &entry = set.ways[w];
+            if (entry.generation != generation || entry.size != size) continue;
+            bool match = true;
+            for (int i = 0; i < W; i++) match &= entry.input[i] == input[i];
+            if (!match) continue;
+            for (int i = 0; i < 8; i++) hash.setword(i, entry.hash[i]);
+            _hits++;
+            return true;
+        }
+        _misses++;
+        return false;
+    }
+    void insert(const uint8_t *buffer, uint64_t size, const uint256_t &hash) {
+        uint64_t input[W];
+        set &set = sets[pack(buffer, size, input) % SETS];
+        entry &entry = set.ways[set.next++ % WAYS];
+        if (entry.generation == generation) _evictions++;
+        entry.generation = generation;
+        entry.size = size;
+        for (int i = 0; i < W; i++) entry.input[i] = input[i];
+        for (int i = 0; i < 8; i++) entry.hash[i] = hash.word(i);
+        _inserts++;
+    }
+    stats get_stats() const { return { _hits, _misses, _inserts, _evictions }; }
+};
+using Sha3Cache = Sha3Cache_t<256, 4>;
+
+static Sha3Cache sha3_cache;
+#endif // NATIVE_CRYPTO
+
 // state abstraction, gateway for the information that is stored permanently in the blockchain
 // this is read at any time, but modified only in the very end of the transaction execution
 // intermediate storage changes are cached by the interpreter as there is need to rollback
@@ -4438,85 +6160,370 @@ public:
     virtual void remove(const uint160_t &address) = 0;
 };
 
-// simple cache implementation, maps keys into values
-template<class K, class V>
-class Cache {
-private:
-    friend class CachedState;
-    static constexpr int minfreeslots = 8; // free entries before rehashing 1/8 (12.5% should be free)
-    static constexpr int minsize = 32; // min number of slots
-    static constexpr int growthdiv = 4; // growth factor 4 means 1/4 (25% per rehashing)
-    struct cache_entry {
+// seed of the fold hash, fixed at startup before any key is hashed
+// the standalone build draws it at random, the contract has no entropy
+// to draw from and keeps this one
+static uint64_t hash_seed = 0x2545f4914f6cdd1dL;
+
+// storage slot key, the account address and the slot key are kept apart
+// and hashed once, when the key is built, so that it can be compared and
+// hashed again by the maps that hold it at no cost
+struct slotkey {
+    uint160_t address;
+    uint256_t key;
+    uint64_t hash; // fold with the seed below
+    uint64_t seed; // process seed when the key was built
+    inline slotkey() {}
+    slotkey(const uint160_t &_address, const uint256_t &_key)
+        : address(_address), key(_key), hash(_key.fold(_address.fold(hash_seed))), seed(hash_seed) {}
+    inline bool operator==(const slotkey &other) const {
+        return (hash == other.hash || seed != other.seed) && key == other.key && address == other.address;
+    }
+    inline uint64_t fold(uint64_t _seed) const { return _seed == seed ? hash : key.fold(address.fold(_seed)); }
+    inline uint32_t murmur3(uint32_t seed) const { return key.murmur3(address.murmur3_(seed)); }
+};
+
+// hashing policies for the flat map, the low bits of the hash select
+// the home slot of a key
+// murmur3 mixes every 32-bit limb of the key thoroughly
+struct Murmur3Hash {
+    template<class K> static inline uint64_t hash(const K &key) { return key.murmur3(0); }
+};
+// folding the 64-bit limbs is enough for addresses and storage keys,
+// and it is seeded per process so that keys can not be picked to collide,
+// maps must not let their iteration order become observable
+struct FoldHash {
+    template<class K> static inline uint64_t hash(const K &key) { return key.fold(hash_seed); }
+};
+
+// open addressing hash map, keys and values are stored inline
+// robin hood probing keeps probe sequences short and lookups only compare
+// keys sharing the home slot, the table is sized in powers of two, and
+// deletions shift the followers back instead of leaving tombstones
+// entries that would probe past maxdist, which only happens when many keys
+// share a hash, are spilled into an overflow list scanned linearly, so that
+// colliding keys cost lookup time but never grow the table beyond the load
+// keys are hashed by the given policy
+template<class K, class V, class H = FoldHash>
+class FlatMap {
+public:
+    struct entry {
         K key;
         V value;
     };
-    uint64_t size = 0; // hash table size
-    struct cache_entry **table = nullptr; // hash table
-    uint64_t key_count = 0; // number os keys in the hash table
-    uint64_t find_index(const K &key) const { return key.murmur3(0) % size; }
-    void grow(uint64_t increment) {
-        uint64_t new_size = size + increment;
-        struct cache_entry **new_table = _new<struct cache_entry*>(new_size);
-        for (uint64_t i = 0; i < new_size; i++) new_table[i] = nullptr;
-        struct cache_entry **old_table = table;
+private:
+    static constexpr uint64_t minsize = 32; // min number of slots, a power of two
+    static constexpr uint64_t loaddiv = 8; // grows when more than 7/8 of the slots are used
+    static constexpr uint8_t maxdist = 255; // probe distance that spills the entry
+    uint64_t size = 0; // number of slots
+    uint64_t count = 0; // number of keys, spilled ones included
+    uint8_t *dist = nullptr; // probe distance plus one for each slot, zero when empty
+    struct entry *entries = nullptr; // slots
+    uint64_t spilled = 0; // number of entries in the overflow list
+    uint64_t spill_size = 0; // overflow list capacity
+    struct entry *spill = nullptr; // overflow list, follows the slots when iterating
+    inline uint64_t home(const K &key) const { return H::hash(key) & (size - 1); }
+    // appends an entry to the overflow list, returns its slot
+    uint64_t overflow(const struct entry &e) {
+        if (spilled == spill_size) {
+            uint64_t new_size = spill_size == 0 ? minsize : 2 * spill_size;
+            struct entry *new_spill = _new<struct entry>(new_size);
+            for (uint64_t i = 0; i < spilled; i++) new_spill[i] = spill[i];
+            _delete(spill);
+            spill = new_spill;
+            spill_size = new_size;
+        }
+        spill[spilled] = e;
+        count++;
+        return size + spilled++;
+    }
+    void grow() {
         uint64_t old_size = size;
-        table = new_table;
-        size = new_size;
-        // rehashing
+        uint8_t *old_dist = dist;
+        struct entry *old_entries = entries;
+        uint64_t old_spilled = spilled;
+        struct entry *old_spill = spill;
+        size = old_size == 0 ? minsize : 2 * old_size;
+        dist = _new<uint8_t>(size);
+        entries = _new<struct entry>(size);
+        for (uint64_t i = 0; i < size; i++) dist[i] = 0;
+        count = 0;
+        spilled = 0;
+        spill_size = 0;
+        spill = nullptr;
         for (uint64_t i = 0; i < old_size; i++) {
-            struct cache_entry *entry = old_table[i];
-            if (entry != nullptr) {
-                uint64_t j = find_index(entry->key);
-                if (table[j] != nullptr) {
-                    _delete(table[j]); key_count--;
-                }
-                table[j] = entry;
+            if (old_dist[i] > 0) place(old_entries[i]);
+        }
+        for (uint64_t i = 0; i < old_spilled; i++) place(old_spill[i]);
+        _delete(old_dist);
+        _delete(old_entries);
+        _delete(old_spill);
+    }
+    // robin hood insertion of an absent key, richer entries give way to poorer ones
+    // the entry carried past maxdist is spilled, returns the slot where the key landed
+    uint64_t place(struct entry e) {
+        uint64_t at = size;
+        uint64_t i = home(e.key);
+        for (uint8_t d = 1; ; d++) {
+            if (d == maxdist) {
+                uint64_t j = overflow(e);
+                return at == size ? j : at;
+            }
+            if (dist[i] == 0) {
+                dist[i] = d;
+                entries[i] = e;
+                count++;
+                return at == size ? i : at;
+            }
+            if (dist[i] < d) {
+                struct entry t = entries[i]; entries[i] = e; e = t;
+                uint8_t u = dist[i]; dist[i] = d; d = u;
+                if (at == size) at = i;
             }
+            i = (i + 1) & (size - 1);
         }
-        _delete(old_table);
     }
 public:
-    ~Cache() { clear(); _delete(table); }
-    const V *get(const K &key) const {
-        if (size == 0) return nullptr;
-        uint64_t i = find_index(key);
-        struct cache_entry *entry = table[i];
-        if (entry != nullptr) {
-            if (entry->key == key) return &entry->value;
+    ~FlatMap() { _delete(dist); _delete(entries); _delete(spill); }
+    // number of keys held without growing by the largest table that fits
+    // in the given bytes, zero if not even the smallest table fits
+    static uint64_t capacity(uint64_t bytes) {
+        uint64_t slot_size = sizeof(struct entry) + 1;
+        if (bytes < minsize * slot_size) return 0;
+        uint64_t slots = minsize;
+        while (slots * 2 * slot_size <= bytes) slots *= 2;
+        return slots * (loaddiv - 1) / loaddiv;
+    }
+    inline uint64_t keys() const { return count; }
+    inline uint64_t slots() const { return size + spilled; }
+    // slot access for iteration, nullptr for empty slots
+    inline struct entry *slot(uint64_t i) { return i >= size ? &spill[i - size] : dist[i] > 0 ? &entries[i] : nullptr; }
+    inline const struct entry *slot(uint64_t i) const { return i >= size ? &spill[i - size] : dist[i] > 0 ? &entries[i] : nullptr; }
+    // the slot holding the key, or slots() if absent
+    uint64_t locate(const K &key) const {
+        if (size == 0) return 0;
+        uint64_t i = home(key);
+        for (uint8_t d = 1; dist[i] >= d; d++) {
+            if (dist[i] == d && entries[i].key == key) return i;
+            i = (i + 1) & (size - 1);
         }
-        return nullptr;
+        for (uint64_t j = 0; j < spilled; j++) {
+            if (spill[j].key == key) return size + j;
+        }
+        return size + spilled;
+    }
+    inline V *find(const K &key) { uint64_t i = locate(key); return i < slots() ? &slot(i)->value : nullptr; }
+    inline const V *find(const K &key) const { uint64_t i = locate(key); return i < slots() ? &slot(i)->value : nullptr; }
+    // inserts a key known to be absent
+    V *insert(const K &key, const V &value) {
+        if ((count + 1) * loaddiv > size * (loaddiv - 1)) grow();
+        struct entry e = { key, value };
+        return &slot(place(e))->value;
+    }
+    // empties a slot shifting back the entries that follow it, or moving
+    // the last spilled entry into it
+    // an entry from a later slot may move into i, so iterations that remove
+    // should visit i again
+    void remove_slot(uint64_t i) {
+        count--;
+        if (i >= size) {
+            assert(i < size + spilled);
+            spill[i - size] = spill[--spilled];
+            return;
+        }
+        assert(dist[i] > 0);
+        uint64_t j = (i + 1) & (size - 1);
+        while (dist[j] > 1) {
+            entries[i] = entries[j];
+            dist[i] = dist[j] - 1;
+            i = j;
+            j = (j + 1) & (size - 1);
+        }
+        dist[i] = 0;
+    }
+    bool remove(const K &key) {
+        uint64_t i = locate(key);
+        if (i == slots()) return false;
+        remove_slot(i);
+        return true;
+    }
+    void clear() {
+        for (uint64_t i = 0; i < size; i++) dist[i] = 0;
+        count = 0;
+        spilled = 0;
+    }
+};
+
+// cache usage counters
+struct CacheStats { uint64_t hits, misses, inserts, evictions; };
+
+// simple cache implementation, maps keys into values
+// it is unbounded unless a byte budget is configured, in which case entries
+// are evicted by the clock algorithm, a hand sweeps the slots clearing the
+// reference bit of the entries used since its last pass and evicts the
+// first entry found unreferenced, so that hot entries are retained
+template<class K, class V>
+class Cache {
+private:
+    struct item {
+        V value;
+        bool referenced;
+    };
+    FlatMap<K, item> map;
+    uint64_t limit = 0; // max number of keys, zero when unbounded
+    uint64_t hand = 0; // clock hand, a slot index
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+    uint64_t _inserts = 0;
+    uint64_t _evictions = 0;
+    void evict() {
+        for (;;) {
+            if (hand >= map.slots()) hand = 0;
+            auto entry = map.slot(hand);
+            if (entry == nullptr) { hand++; continue; }
+            if (entry->value.referenced) { entry->value.referenced = false; hand++; continue; }
+            map.remove_slot(hand);
+            _evictions++;
+            return;
+        }
+    }
+public:
+    // bounds the cache to the keys that fit in the budget without the table
+    // growing, at least one, dropping all entries, a zero budget unbounds it
+    void configure(uint64_t budget) {
+        map.clear();
+        hand = 0;
+        limit = budget > 0 ? _max(1, FlatMap<K, item>::capacity(budget)) : 0;
+    }
+    const V *get(const K &key) {
+        item *p = map.find(key);
+        if (p == nullptr) { _misses++; return nullptr; }
+        p->referenced = true;
+        _hits++;
+        return &p->value;
     }
     void set(const K &key, const V &value) {
-        if (key_count + (size / minfreeslots) >= size) grow(_max(minsize, size / growthdiv));
-        uint64_t i = find_index(key);
-        struct cache_entry *entry = table[i];
-        if (entry == nullptr) {
-            entry = _new<struct cache_entry>(1); key_count++;
-            table[i] = entry;
-        }
-        entry->key = key;
-        entry->value = value;
-    }
-    void del(const K &key) {
-        if (size == 0) return;
-        uint64_t i = find_index(key);
-        struct cache_entry *entry = table[i];
-        if (entry != nullptr) {
-            if (entry->key == key) {
-                _delete(table[i]); key_count--;
-                table[i] = nullptr;
-            }
+        item *p = map.find(key);
+        if (p != nullptr) { p->value = value; p->referenced = true; return; }
+        if (limit > 0 && map.keys() >= limit) evict();
+        map.insert(key, { value, false });
+        _inserts++;
+    }
+    inline void del(const K &key) { map.remove(key); }
+    inline void clear() { map.clear(); }
+    CacheStats get_stats() const { return { _hits, _misses, _inserts, _evictions }; }
+};
+
+// storage data cache, maps account slots into values
+// slots are indexed by account, each account lists the keys it has cached,
+// so that clearing an account only visits its own slots, and each slot
+// records its position in that list, so that evicting it is constant time
+// it is bounded and evicts like Cache, with the clock hand over the slots
+class DataCache {
+private:
+    static constexpr uint32_t minkeys = 4; // min key list capacity
+    struct slot {
+        uint256_t value;
+        uint32_t position; // index in the key list of the account
+        bool referenced;
+    };
+    struct account {
+        uint256_t *keys; // slot keys cached for the account
+        uint32_t count; // number of keys
+        uint32_t size; // key list capacity
+    };
+    FlatMap<slotkey, struct slot> slots;
+    FlatMap<uint160_t, struct account> accounts;
+    uint64_t limit = 0; // max number of slots, zero when unbounded
+    uint64_t hand = 0; // clock hand, a slot index
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+    uint64_t _inserts = 0;
+    uint64_t _evictions = 0;
+    void link(const uint160_t &address, const uint256_t &key, uint32_t &position) {
+        struct account *a = accounts.find(address);
+        if (a == nullptr) a = accounts.insert(address, { nullptr, 0, 0 });
+        if (a->count == a->size) {
+            uint32_t new_size = _max(minkeys, 2 * a->size);
+            uint256_t *new_keys = _new<uint256_t>(new_size);
+            for (uint32_t i = 0; i < a->count; i++) new_keys[i] = a->keys[i];
+            _delete(a->keys);
+            a->keys = new_keys;
+            a->size = new_size;
+        }
+        position = a->count;
+        a->keys[a->count++] = key;
+    }
+    // removes a key from the list of the account moving the last key into its place
+    void unlink(const uint160_t &address, uint32_t position) {
+        struct account *a = accounts.find(address);
+        assert(a != nullptr && position < a->count);
+        a->count--;
+        if (position < a->count) {
+            a->keys[position] = a->keys[a->count];
+            struct slot *moved = slots.find(slotkey(address, a->keys[position]));
+            assert(moved != nullptr);
+            moved->position = position;
+        }
+        if (a->count == 0) {
+            _delete(a->keys);
+            accounts.remove(address);
+        }
+    }
+    void evict() {
+        for (;;) {
+            if (hand >= slots.slots()) hand = 0;
+            auto entry = slots.slot(hand);
+            if (entry == nullptr) { hand++; continue; }
+            if (entry->value.referenced) { entry->value.referenced = false; hand++; continue; }
+            unlink(entry->key.address, entry->value.position);
+            slots.remove_slot(hand);
+            _evictions++;
+            return;
         }
     }
+public:
+    ~DataCache() { clear(); }
+    // bounds the cache as Cache does, the slot map takes three quarters
+    // of the budget and the key lists the rest
+    void configure(uint64_t budget) {
+        clear();
+        hand = 0;
+        limit = budget > 0 ? _max(1, FlatMap<slotkey, struct slot>::capacity(budget - budget / 4)) : 0;
+    }
+    const uint256_t *get(const slotkey &k) {
+        struct slot *p = slots.find(k);
+        if (p == nullptr) { _misses++; return nullptr; }
+        p->referenced = true;
+        _hits++;
+        return &p->value;
+    }
+    void set(const slotkey &k, const uint256_t &value) {
+        struct slot *p = slots.find(k);
+        if (p != nullptr) { p->value = value; p->referenced = true; return; }
+        if (limit > 0 && slots.keys() >= limit) evict();
+        struct slot e = { value, 0, false };
+        link(k.address, k.key, e.position);
+        slots.insert(k, e);
+        _inserts++;
+    }
+    // drops the slots of an account
+    void del(const uint160_t &address) {
+        struct account *a = accounts.find(address);
+        if (a == nullptr) return;
+        for (uint32_t i = 0; i < a->count; i++) slots.remove(slotkey(address, a->keys[i]));
+        _delete(a->keys);
+        accounts.remove(address);
+    }
     void clear() {
-        for (uint64_t i = 0; i < size; i++) {
-            if (table[i] != nullptr) {
-                _delete(table[i]); key_count--;
-            }
-            table[i] = nullptr;
+        for (uint64_t i = 0; i < accounts.slots(); i++) {
+            auto entry = accounts.slot(i);
+            if (entry != nullptr) _delete(entry->value.keys);
         }
-        assert(key_count == 0);
+        accounts.clear();
+        slots.clear();
     }
+    CacheStats get_stats() const { return { _hits, _misses, _inserts, _evictions }; }
 };
 
 // provides a read cache view of the state
@@ -4526,9 +6533,21 @@ private:
     mutable Cache<uint160_t, uint64_t> nonce_cache; // caches state nonce for faster access
     mutable Cache<uint160_t, uint256_t> balance_cache; // caches state balance for faster access
     mutable Cache<uint160_t, uint256_t> codehash_cache; // caches state codehash for faster access
-    mutable Cache<uint416_t, uint256_t> data_cache; // caches state data for faster access
+    mutable DataCache data_cache; // caches state data for faster access
 public:
+    struct stats { CacheStats nonce, balance, codehash, data; };
     CachedState(State *_underlying) : underlying(_underlying) {}
+    // bounds the caches to a byte budget, storage data takes the larger
+    // share as it has the most entries, a zero budget unbounds them
+    void configure(uint64_t budget) {
+        nonce_cache.configure(budget / 8);
+        balance_cache.configure(budget / 8);
+        codehash_cache.configure(budget / 8);
+        data_cache.configure(budget - 3 * (budget / 8));
+    }
+    stats get_stats() const {
+        return { nonce_cache.get_stats(), balance_cache.get_stats(), codehash_cache.get_stats(), data_cache.get_stats() };
+    }
     uint64_t get_nonce(const uint160_t &address) const {
         const uint64_t *p_nonce = nonce_cache.get(address);
         if (p_nonce != nullptr) return *p_nonce;
@@ -4569,17 +6588,21 @@ public:
         underlying->store_code(codehash, code, code_size);
     }
     uint256_t load(const uint160_t &address, const uint256_t &key) const {
-        uint416_t extkey = ((uint416_t)address << 256) | (uint416_t)key;
-        const uint256_t *p_value = data_cache.get(extkey);
+        return load(slotkey(address, key));
+    }
+    void store(const uint160_t &address, const uint256_t &key, const uint256_t& value) {
+        store(slotkey(address, key), value);
+    }
+    uint256_t load(const slotkey &slot) const {
+        const uint256_t *p_value = data_cache.get(slot);
         if (p_value != nullptr) return *p_value;
-        uint256_t value = underlying->load(address, key);
-        data_cache.set(extkey, value);
+        uint256_t value = underlying->load(slot.address, slot.key);
+        data_cache.set(slot, value);
         return value;
     }
-    void store(const uint160_t &address, const uint256_t &key, const uint256_t& value) {
-        uint416_t extkey = ((uint416_t)address << 256) | (uint416_t)key;
-        data_cache.set(extkey, value);
-        underlying->store(address, key, value);
+    void store(const slotkey &slot, const uint256_t& value) {
+        data_cache.set(slot, value);
+        underlying->store(slot.address, slot.key, value);
     }
     void log0(const uint160_t &address, const uint8_t *data, uint64_t data_size) {
         underlying->log0(address, data, data_size);
@@ -4598,16 +6621,7 @@ public:
     }
     void clear(const uint160_t &address) {
         underlying->clear(address);
-        for (uint64_t i = 0; i < data_cache.size; i++) {
-            auto entry = data_cache.table[i];
-            if (entry != nullptr) {
-                uint160_t _address = (uint160_t)(entry->key >> 256);
-                if (_address == address) {
-                    _delete(data_cache.table[i]); data_cache.key_count--;
-                    data_cache.table[i] = nullptr;
-                }
-            }
-        }
+        data_cache.del(address);
     }
     void remove(const uint160_t &address) {
         underlying->remove(address);
@@ -4628,150 +6642,119 @@ public:
 
 // simple hash map implementation, maps keys into values
 // used to hold temporary nonces, balances, and storage values
-// supports nested commits and rollbacks
+// supports nested commits and rollbacks through an undo journal, so that
+// snapshot, commit and rollback cost as much as the entries written since
 template<class K, class V>
 class Store : public Transactional {
 private:
-    friend class Storage;
-    static constexpr int avgmaxperslot = 3; // approximate max entries per slot before rehashing
-    static constexpr int minsize = 32; // min number of slots
-    static constexpr int growthdiv = 4; // growth factor 4 means 1/4 (25% per rehashing)
-    // list of values, stored according to snapshot order (lifo, newest first)
-    struct value_stack {
-        uint32_t serial;
+    static constexpr int minjournal = 32; // min number of journal entries
+    // current value of a key
+    // serial is the snapshot level of the latest journal entry for the key
+    struct versioned {
         V value;
-        struct value_stack *next;
+        uint32_t serial;
     };
-    // list of keys in no particular order
-    struct key_list {
+    // journal entry, the value a key had before its first write at a snapshot level
+    // entries are kept in snapshot level order (oldest first)
+    struct undo {
         K key;
-        struct value_stack *values;
-        struct key_list *next;
+        V value; // previous value
+        uint32_t serial; // snapshot level of the write
+        uint32_t saved; // previous serial of the key
+        bool existed; // false if the key was created by the write
     };
-    uint64_t size = 0; // hash table size
-    struct key_list **table = nullptr; // hash table, each entry is a list of keys each pointing to a list of values
-    uint64_t key_count = 0; // number os keys in the hash table
+    FlatMap<K, struct versioned> map; // current values
     uint64_t serial = 1; // serial number used to mark snapshots
-    uint64_t find_index(const K &key) const { return key.murmur3(0) % size; }
-    void grow(uint64_t increment) {
-        uint64_t new_size = size + increment;
-        struct key_list **new_table = _new<struct key_list*>(new_size);
-        for (uint64_t i = 0; i < new_size; i++) new_table[i] = nullptr;
-        struct key_list **old_table = table;
-        uint64_t old_size = size;
-        table = new_table;
-        size = new_size;
-        // rehashing
-        for (uint64_t i = 0; i < old_size; i++) {
-            struct key_list *keys = old_table[i];
-            while (keys != nullptr) {
-                uint64_t j = find_index(keys->key);
-                struct key_list *next = keys->next;
-                keys->next = table[j];
-                table[j] = keys;
-                keys = next;
-            }
+    struct undo *journal = nullptr; // undo journal
+    uint64_t journal_size = 0; // journal capacity
+    uint64_t journal_count = 0; // number of journal entries
+    // saves the current state of the key before it is first written at this level
+    void save(const struct versioned *current, const K &key) {
+        if (journal_count == journal_size) {
+            uint64_t new_size = _max(minjournal, 2 * journal_size);
+            struct undo *new_journal = _new<struct undo>(new_size);
+            for (uint64_t i = 0; i < journal_count; i++) new_journal[i] = journal[i];
+            _delete(journal);
+            journal = new_journal;
+            journal_size = new_size;
+        }
+        struct undo &entry = journal[journal_count++];
+        entry.key = key;
+        entry.serial = serial;
+        entry.existed = current != nullptr;
+        if (current != nullptr) {
+            entry.value = current->value;
+            entry.saved = current->serial;
+        } else {
+            entry.saved = 0;
         }
-        _delete(old_table);
     }
 public:
-    ~Store() { rollback(0); _delete(table); }
-    const V &get(const K &key, const V &default_value) const {
-        if (size == 0) return default_value;
-        uint64_t i = find_index(key);
-        for (struct key_list *keys = table[i]; keys != nullptr; keys = keys->next) {
-            if (keys->key == key) {
-                if (keys->values != nullptr) return keys->values->value;
-                return default_value;
-            }
-        }
-        return default_value;
+    ~Store() { _delete(journal); }
+    // the current value of a key, nullptr if not written
+    inline const V *find(const K &key) const {
+        const struct versioned *current = map.find(key);
+        return current != nullptr ? &current->value : nullptr;
     }
+    const V &get(const K &key, const V &default_value) const {
+        const struct versioned *current = map.find(key);
+        return current != nullptr ? current->value : default_value;
+    }
+    // the keys in the order they were first written, unlike the map order
+    // it does not depend on the hash seed, each key in the map has exactly
+    // one journal entry that created it, rollbacks drop both together
+    inline uint64_t writes() const { return journal_count; }
+    // the key created by the i-th journal entry, nullptr if it did not create one
+    inline const K *created(uint64_t i) const { return journal[i].existed ? nullptr : &journal[i].key; }
     void set(const K &key, const V &value, const V &default_value) {
-        if (key_count / avgmaxperslot >= size) grow(_max(minsize, size / growthdiv));
-        uint64_t i = find_index(key);
-        struct key_list *prev = nullptr;
-        struct key_list *keys = table[i];
-        while (keys != nullptr) {
-            if (keys->key == key) {
-                if (prev == nullptr) table[i] = keys->next; else prev->next = keys->next;
-                keys->next = table[i];
-                table[i] = keys;
-                break;
-            }
-            prev = keys;
-            keys = keys->next;
-        }
-        if (keys == nullptr) {
+        struct versioned *current = map.find(key);
+        if (current == nullptr) {
             if (value == default_value) return;
-            keys = _new<struct key_list>(1); key_count++;
-            keys->key = key;
-            keys->values = nullptr;
-            keys->next = table[i];
-            table[i] = keys;
-        }
-        assert(keys->values == nullptr || keys->values->serial <= serial);
-        if (keys->values == nullptr || (keys->values->serial < serial && keys->values->value != value)) {
-            struct value_stack *values = _new<struct value_stack>(1);
-            values->serial = serial;
-            values->next = keys->values;
-            keys->values = values;
-        }
-        keys->values->value = value;
-        assert(keys->values->next == nullptr || keys->values->next->serial < serial);
+            save(nullptr, key);
+            struct versioned v = { value, (uint32_t)serial };
+            map.insert(key, v);
+            return;
+        }
+        if (current->value == value) return;
+        assert(current->serial <= serial);
+        if (current->serial < serial) {
+            save(current, key);
+            current->serial = serial;
+        }
+        current->value = value;
     }
+    // snapshots are lazy, a level only gets journal entries once written
     inline uint64_t snapshot() { return serial++; }
-    // flattens all entry values with serial greater than snapshot
+    // folds the journal entries above snapshot into it
+    // only the oldest entry for each key is kept, the others are redundant
     void commit(uint64_t snapshot) {
         assert(snapshot < serial);
-        for (uint64_t i = 0; i < size; i++) {
-            struct key_list *prev = nullptr;
-            struct key_list *keys = table[i];
-            while (keys != nullptr) {
-                if (keys->values == nullptr) {
-                    struct key_list *next = keys->next;
-                    _delete(keys); key_count--;
-                    keys = next;
-                    if (prev == nullptr) table[i] = keys; else prev->next = keys;
-                    continue;
-                }
-                if (keys->values->serial > snapshot) {
-                    while (keys->values->next != nullptr && keys->values->next->serial >= snapshot) {
-                        assert(keys->values->next->serial == snapshot);
-                        struct value_stack *next = keys->values->next->next;
-                        _delete(keys->values->next);
-                        keys->values->next = next;
-                    }
-                    keys->values->serial = snapshot;
-                }
-                prev = keys;
-                keys = keys->next;
-            }
+        uint64_t base = journal_count;
+        while (base > 0 && journal[base-1].serial > snapshot) base--;
+        uint64_t count = base;
+        for (uint64_t i = base; i < journal_count; i++) {
+            struct undo &entry = journal[i];
+            struct versioned *current = map.find(entry.key);
+            assert(current != nullptr);
+            current->serial = snapshot;
+            if (entry.existed && entry.saved >= snapshot) continue;
+            entry.serial = snapshot;
+            if (count < i) journal[count] = entry;
+            count++;
         }
+        journal_count = count;
         serial = snapshot;
     }
-    // removes all entry values with serial greater than snapshot
+    // undoes the journal entries above snapshot, newest first
     void rollback(uint64_t snapshot) {
         assert(snapshot < serial);
-        for (uint64_t i = 0; i < size; i++) {
-            struct key_list *prev = nullptr;
-            struct key_list *keys = table[i];
-            while (keys != nullptr) {
-                while (keys->values != nullptr && keys->values->serial > snapshot) {
-                    struct value_stack *next = keys->values->next;
-                    _delete(keys->values);
-                    keys->values = next;
-                }
-                if (keys->values == nullptr) {
-                    struct key_list *next = keys->next;
-                    _delete(keys); key_count--;
-                    keys = next;
-                    if (prev == nullptr) table[i] = keys; else prev->next = keys;
-                    continue;
-                }
-                prev = keys;
-                keys = keys->next;
-            }
+        while (journal_count > 0 && journal[journal_count-1].serial > snapshot) {
+            struct undo &entry = journal[--journal_count];
+            if (!entry.existed) { map.remove(entry.key); continue; }
+            struct versioned *current = map.find(entry.key);
+            assert(current != nullptr);
+            current->value = entry.value;
+            current->serial = entry.saved;
         }
         serial = snapshot;
     }
@@ -4891,7 +6874,7 @@ protected:
     Store<uint160_t, uint64_t> nonces; // storage area for nonces
     Store<uint160_t, uint256_t> balances; // storage area for balances
     Store<uint160_t, uint256_t> codehashes; // storage area for code
-    Store<uint416_t, uint256_t> data; // storage area for data
+    Store<slotkey, uint256_t> data; // storage area for data
     Store<uint160_t, bool> created; // creation flag
     Store<uint160_t, bool> destructed; // destruction flag
     Log logs; // storage for logs
@@ -4962,16 +6945,27 @@ public:
     }
     // data access methods
     uint256_t load(const uint160_t &address, const uint256_t &key) const {
-        uint416_t extkey = ((uint416_t)address << 256) | (uint416_t)key;
-        return data.get(extkey, _load(address, key));
+        slotkey slot(address, key);
+        const uint256_t *current = data.find(slot);
+        return current != nullptr ? *current : _load(slot);
     }
     void store(const uint160_t &address, const uint256_t &key, const uint256_t& value) {
-        uint416_t extkey = ((uint416_t)address << 256) | (uint416_t)key;
-        data.set(extkey, value, _load(address, key));
+        slotkey slot(address, key);
+        data.set(slot, value, _load(slot));
+    }
+    // loads both the current and the original value of a slot
+    void load(const slotkey &slot, uint256_t &current, uint256_t &original) const {
+        original = _load(slot);
+        const uint256_t *p_current = data.find(slot);
+        current = p_current != nullptr ? *p_current : original;
+    }
+    // stores a value given the original one, as obtained above
+    void store(const slotkey &slot, const uint256_t &value, const uint256_t &original) {
+        data.set(slot, value, original);
     }
     // loads original value directly from the state
-    uint256_t _load(const uint160_t &address, const uint256_t &key) const {
-        return created.get(address, false) ? 0 : state.load(address, key);
+    uint256_t _load(const slotkey &slot) const {
+        return created.get(slot.address, false) ? 0 : state.load(slot);
     }
     // address storage clearing
     void clear(const uint160_t &address) {
@@ -5059,61 +7053,46 @@ public:
         success ? commit(snapshot) : rollback(snapshot);
     }
     // method to persist changes to the state, called at the end of a transaction
+    // keys are visited in write order, so that the effects on the state do
+    // not depend on the hash seed
     void flush() {
         Store<uint160_t, bool> touched;
-        for (uint64_t i = 0; i < created.size; i++) {
-            for (auto keys = created.table[i]; keys != nullptr; keys = keys->next) {
-                if (keys->values != nullptr) {
-                    if (keys->values->value) state.clear(keys->key);
-                }
-            }
+        for (uint64_t i = 0; i < created.writes(); i++) {
+            const uint160_t *key = created.created(i);
+            if (key != nullptr && created.get(*key, false)) state.clear(*key);
         }
-        for (uint64_t i = 0; i < nonces.size; i++) {
-            for (auto keys = nonces.table[i]; keys != nullptr; keys = keys->next) {
-                if (keys->values != nullptr) {
-                    state.set_nonce(keys->key, keys->values->value);
-                    touched.set(keys->key, true, false);
-                }
+        for (uint64_t i = 0; i < nonces.writes(); i++) {
+            const uint160_t *key = nonces.created(i);
+            if (key != nullptr) {
+                state.set_nonce(*key, *nonces.find(*key));
+                touched.set(*key, true, false);
             }
         }
-        for (uint64_t i = 0; i < balances.size; i++) {
-            for (auto keys = balances.table[i]; keys != nullptr; keys = keys->next) {
-                if (keys->values != nullptr) {
-                    state.set_balance(keys->key, keys->values->value);
-                    touched.set(keys->key, true, false);
-                }
+        for (uint64_t i = 0; i < balances.writes(); i++) {
+            const uint160_t *key = balances.created(i);
+            if (key != nullptr) {
+                state.set_balance(*key, *balances.find(*key));
+                touched.set(*key, true, false);
             }
         }
-        for (uint64_t i = 0; i < codehashes.size; i++) {
-            for (auto keys = codehashes.table[i]; keys != nullptr; keys = keys->next) {
-                if (keys->values != nullptr) {
-                    state.set_codehash(keys->key, keys->values->value);
-                    touched.set(keys->key, true, false);
-                }
+        for (uint64_t i = 0; i < codehashes.writes(); i++) {
+            const uint160_t *key = codehashes.created(i);
+            if (key != nullptr) {
+                state.set_codehash(*key, *codehashes.find(*key));
+                touched.set(*key, true, false);
             }
         }
-        for (uint64_t i = 0; i < data.size; i++) {
-            for (auto keys = data.table[i]; keys != nullptr; keys = keys->next) {
-                uint160_t address = (uint160_t)(keys->key >> 256);
-                uint256_t key = (uint256_t)keys->key;
-                if (keys->values != nullptr) {
-                    state.store(address, key, keys->values->value);
-                }
-            }
+        for (uint64_t i = 0; i < data.writes(); i++) {
+            const slotkey *key = data.created(i);
+            if (key != nullptr) state.store(*key, *data.find(*key));
         }
-        for (uint64_t i = 0; i < destructed.size; i++) {
-            for (auto keys = destructed.table[i]; keys != nullptr; keys = keys->next) {
-                if (keys->values != nullptr) {
-                    if (keys->values->value) state.remove(keys->key);
-                }
-            }
+        for (uint64_t i = 0; i < destructed.writes(); i++) {
+            const uint160_t *key = destructed.created(i);
+            if (key != nullptr && destructed.get(*key, false)) state.remove(*key);
         }
-        for (uint64_t i = 0; i < touched.size; i++) {
-            for (auto keys = touched.table[i]; keys != nullptr; keys = keys->next) {
-                if (keys->values != nullptr) {
-                    if (is_empty(keys->key)) state.remove(keys->key);
-                }
-            }
+        for (uint64_t i = 0; i < touched.writes(); i++) {
+            const uint160_t *key = touched.created(i);
+            if (key != nullptr && is_empty(*key)) state.remove(*key);
         }
         for (uint64_t i = 0; i < logs.count; i++) {
             auto entry = &logs.entries[i];
@@ -5501,6 +7480,152 @@ static void _throws(vm_blake2f)(Release release,
     w2b64le(h7, &return_data[return_offset]); return_offset += 8;
 }
 
+// a bounded cache of precompiled contract results, since retries,
+// simulations followed by actual execution, and multicall batches repeat
+// the same expensive inputs
+// entries are keyed by contract, release and the hash of the input and
+// keep the output bytes along with the gas consumed, so that a hit is
+// charged exactly as the call it replaces
+// entries are kept in least recently used order and evicted once their
+// total size exceeds the byte budget
+// it is off unless contracts are enabled in the mask, results of calls
+// that fail are never cached
+// the contract never enables it, so it is left out of that build
+#ifndef NATIVE_CRYPTO
+class PrecompileCache {
+public:
+    static constexpr uint64_t EXPENSIVE = 0
+        | (1 << ECRECOVER)
+        | (1 << BIGMODEXP)
+        | (1 << BN256SCALARMUL)
+        | (1 << BN256PAIRING);
+    struct stats { uint64_t hits, misses, inserts, evictions; };
+    static constexpr uint64_t MAXBUDGET = 1 << 30; // budget cap in bytes
+private:
+    static constexpr uint64_t minsize = 64; // min hash table size, a power of two
+    struct entry {
+        uint256_t hash;
+        uint64_t input_size;
+        uint8_t id;
+        Release release;
+        uint64_t gas;
+        uint8_t *output;
+        uint64_t output_size;
+        entry *next; // hash chain
+        entry *newer, *older; // usage list
+    };
+    uint64_t mask = 0;
+    uint64_t budget = 0; // max bytes held
+    uint64_t used = 0; // bytes held, entries and outputs
+    uint64_t count = 0; // entries held
+    uint64_t size = 0; // hash table size, a power of two
+    entry **table = nullptr; // hash table
+    entry *newest = nullptr, *oldest = nullptr;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+    uint64_t _inserts = 0;
+    uint64_t _evictions = 0;
+    entry **find(uint8_t id, Release release, const uint256_t &hash, uint64_t input_size) {
+        entry **p = &table[hash.word(0) & (size - 1)];
+        for (; *p != nullptr; p = &(*p)->next) {
+            entry *e = *p;
+            if (e->id == id && e->release == release && e->input_size == input_size && e->hash == hash) break;
+        }
+        return p;
+    }
+    void unlink(entry *e) {
+        if (e->newer != nullptr) e->newer->older = e->older; else newest = e->older;
+        if (e->older != nullptr) e->older->newer = e->newer; else oldest = e->newer;
+    }
+    void link(entry *e) {
+        e->newer = nullptr;
+        e->older = newest;
+        if (newest != nullptr) newest->newer = e; else oldest = e;
+        newest = e;
+    }
+    // doubles the hash table, rehashing the entries through the usage list
+    void grow() {
+        _delete(table);
+        size *= 2;
+        table = _new<entry*>(size);
+        for (uint64_t i = 0; i < size; i++) table[i] = nullptr;
+        for (entry *e = oldest; e != nullptr; e = e->newer) {
+            entry **p = &table[e->hash.word(0) & (size - 1)];
+            e->next = *p;
+            *p = e;
+        }
+    }
+    void evict(entry *e) {
+        entry **p = find(e->id, e->release, e->hash, e->input_size);
+        assert(*p == e);
+        *p = e->next;
+        unlink(e);
+        used -= sizeof(entry) + e->output_size;
+        count--;
+        _delete(e->output);
+        _delete(e);
+    }
+public:
+    ~PrecompileCache() { configure(0, 0); }
+    // enables the contracts whose bit is set in the mask, dropping all entries
+    // the budget is capped to MAXBUDGET, the hash table starts small and
+    // doubles with the entries held
+    void configure(uint64_t _mask, uint64_t _budget) {
+        while (oldest != nullptr) evict(oldest);
+        _delete(table);
+        table = nullptr;
+        mask = _budget > 0 ? _mask : 0;
+        budget = _min(_budget, MAXBUDGET);
+        size = minsize;
+        if (mask != 0) {
+            table = _new<entry*>(size);
+            for (uint64_t i = 0; i < size; i++) table[i] = nullptr;
+        }
+    }
+    inline bool enabled(uint8_t id) const { return (mask & ((uint64_t)1 << id)) > 0; }
+    bool lookup(uint8_t id, Release release, const uint256_t &hash, uint64_t input_size,
+        const uint8_t *&output, uint64_t &output_size, uint64_t &gas) {
+        entry *e = *find(id, release, hash, input_size);
+        if (e == nullptr) { _misses++; return false; }
+        unlink(e);
+        link(e);
+        output = e->output;
+        output_size = e->output_size;
+        gas = e->gas;
+        _hits++;
+        return true;
+    }
+    void insert(uint8_t id, Release release, const uint256_t &hash, uint64_t input_size,
+        const uint8_t *output, uint64_t output_size, uint64_t gas) {
+        uint64_t bytes = sizeof(entry) + output_size;
+        if (bytes > budget) return;
+        entry **p = find(id, release, hash, input_size);
+        if (*p != nullptr) return;
+        while (used + bytes > budget) { evict(oldest); _evictions++; }
+        if (count == size) grow();
+        p = find(id, release, hash, input_size);
+        entry *e = _new<entry>(1);
+        e->hash = hash;
+        e->input_size = input_size;
+        e->id = id;
+        e->release = release;
+        e->gas = gas;
+        e->output = _new<uint8_t>(output_size);
+        for (uint64_t i = 0; i < output_size; i++) e->output[i] = output[i];
+        e->output_size = output_size;
+        e->next = nullptr;
+        *p = e;
+        link(e);
+        used += bytes;
+        count++;
+        _inserts++;
+    }
+    stats get_stats() const { return { _hits, _misses, _inserts, _evictions }; }
+};
+
+static PrecompileCache precompile_cache;
+#endif // NATIVE_CRYPTO
+
 // ** interpreter **
 
 // this is the main interpreter routine, which implements all opcodes
@@ -5521,49 +7646,70 @@ static bool _throws(vm_run)(Release release, Block &block, Storage &storage,
     if (code_size == 0) { // do nothing if contract code is empty
         if ((intptr_t)code < 256) { // but first test for precompiled contract
             uint8_t opc = (intptr_t)code;
-            if ((pre[release] & (_1 << opc)) > 0) { // and which precompiled contracts are available
+            if (pre[release].has(opc)) { // and which precompiled contracts are available
 #ifndef NDEBUG
                 if (std::getenv("EVM_DEBUG")) std::cout << prenames[opc] << std::endl;
 #endif // NDEBUG
+#ifndef NATIVE_CRYPTO
+                bool cached = precompile_cache.enabled(opc);
+                uint256_t hash;
+                if (cached) {
+                    hash = sha3(call_data, call_size);
+                    const uint8_t *output;
+                    uint64_t output_size, cost;
+                    if (precompile_cache.lookup(opc, release, hash, call_size, output, output_size, cost)) {
+                        _handles0(consume_gas)(gas, cost);
+                        return_size = output_size;
+                        _ensure_capacity(return_data, return_size, return_capacity);
+                        for (uint64_t i = 0; i < return_size; i++) return_data[i] = output[i];
+                        return true;
+                    }
+                }
+                uint64_t initial_gas = gas;
+#endif // NATIVE_CRYPTO
                 switch (opc) {
                 case ECRECOVER: {
                     _handles0(vm_ecrecover)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 case SHA256: {
                     _handles0(vm_sha256)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 case RIPEMD160: {
                     _handles0(vm_ripemd160)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 case DATACOPY: {
                     _handles0(vm_datacopy)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 case BIGMODEXP: {
                     _handles0(vm_bigmodexp)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 case BN256ADD: {
                     _handles0(vm_bn256add)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 case BN256SCALARMUL: {
                     _handles0(vm_bn256scalarmul)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 case BN256PAIRING: {
                     _handles0(vm_bn256pairing)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 case BLAKE2F: {
                     _handles0(vm_blake2f)(release, call_data, call_size, return_data, return_size, return_capacity, gas);
-                    return true;
+                    break;
                 }
                 default: assert(false);
                 }
+#ifndef NATIVE_CRYPTO
+                if (cached) precompile_cache.insert(opc, release, hash, call_size, return_data, return_size, initial_gas - gas);
+#endif // NATIVE_CRYPTO
+                return true;
             }
         }
         return_size = 0;
@@ -5579,9 +7725,9 @@ static bool _throws(vm_run)(Release release, Block &block, Storage &storage,
 #ifndef NDEBUG
         if (std::getenv("EVM_DEBUG")) std::cout << opcodes[opc] << std::endl;
 #endif // NDEBUG
-        if ((is[release] & (_1 << opc)) == 0) _throw0(INVALID_OPCODE); // check is the opcode is available
+        if (!is[release].has(opc)) _throw0(INVALID_OPCODE); // check is the opcode is available
         _handles0(stack_check)(opc, stack.top()); // validates the stack
-        if (read_only && (is_writes & (_1 << opc)) > 0) _throw0(ILLEGAL_UPDATE); // validates write opcode in read-only mode
+        if (read_only && is_writes.has(opc)) _throw0(ILLEGAL_UPDATE); // validates write opcode in read-only mode
         _handles0(consume_gas)(gas, gas_opcode(release, opc)); // consumes the constant part of gas for the opcode
         switch (opc) {
         case STOP: { return_size = 0; return true; }
@@ -5641,9 +7787,22 @@ static bool _throws(vm_run)(Release release, Block &block, Storage &storage,
             uint64_t offset = v1.cast64(), size = v2.cast64();
             _handles0(consume_gas)(gas, gas_memory(release, memory.size(), offset + size));
             _handles0(consume_gas)(gas, gas_sha3(release, size));
-            local<uint8_t> buffer_l(size); uint8_t *buffer = buffer_l.data;
-            memory.dump(offset, size, buffer);
-            stack.push(sha3(buffer, size));
+#ifndef NATIVE_CRYPTO
+            if (sha3_cache.enabled(size)) {
+                uint8_t buffer[Sha3Cache::MAX];
+                memory.dump(offset, size, buffer);
+                uint256_t hash;
+                if (!sha3_cache.lookup(buffer, size, hash)) {
+                    hash = sha3(buffer, size);
+                    sha3_cache.insert(buffer, size, hash);
+                }
+                stack.push(hash);
+                break;
+            }
+#endif // NATIVE_CRYPTO
+            Keccak256 keccak;
+            memory.absorb(keccak, offset, size);
+            stack.push(keccak.finish());
             break;
         }
         case ADDRESS: { stack.push((uint256_t)owner_address); break; }
@@ -5752,8 +7911,9 @@ static bool _throws(vm_run)(Release release, Block &block, Storage &storage,
         case SLOAD: { uint256_t address = stack.pop(); stack.push(storage.load(owner_address, address)); break; }
         case SSTORE: {
             uint256_t address = stack.pop(), value = stack.pop();
-            uint256_t current = storage.load(owner_address, address);
-            uint256_t original = storage._load(owner_address, address);
+            slotkey slot(owner_address, address);
+            uint256_t current, original;
+            storage.load(slot, current, original);
             bool init = original == 0;
             bool dirty = current != original;
             bool noop = current == value;
@@ -5763,7 +7923,7 @@ static bool _throws(vm_run)(Release release, Block &block, Storage &storage,
             _handles0(consume_gas)(gas, gas_sstore(release, gas, init, dirty, noop, sets, clears, cleans));
             storage.add_refund(gas_refund_sstore(release, init, dirty, noop, sets, clears, cleans));
             storage.sub_refund(gas_unrefund_sstore(release, init, dirty, noop, sets, clears, cleans));
-            storage.store(owner_address, address, value);
+            storage.store(slot, value, original);
             break;
         }
         case JUMP: {
@@ -6208,20 +8368,17 @@ static bool _throws(vm_run)(Release release, Block &block, Storage &storage,
 // the sender's balance
 // this routine is a customized version of opcodes CALL and CREATE with additional
 // handling of the transaction and state
-static void _throws(vm_txn)(Block &block, State &state, const uint8_t *buffer, uint64_t size, uint160_t sender, bool pays_gas)
+// the decoding and sender recovery can be performed ahead of time, possibly
+// in batches, by using the second form which takes a decoded and verified
+// transaction and its sender
+static void _throws(vm_txn)(Block &block, State &state, const struct txn &txn, const uint160_t &from, bool pays_gas)
 {
     Release release = get_release(block.forknumber());
     Storage storage(&state);
+#ifndef NATIVE_CRYPTO
+    sha3_cache.begin_transaction();
+#endif // NATIVE_CRYPTO
 
-    struct txn txn = {0, 0, 0, false, 0, 0, nullptr, 0, false, 0, 0, 0};
-    _handles(decode_txn)(buffer, size, txn);
-    _handles(verify_txn)(release, txn);
-
-    uint160_t from = sender;
-    if (sender == 0) {
-        uint256_t h = _handles(hash_txn)(txn);
-        from = _handles(ecrecover)(h, txn.v, txn.r, txn.s);
-    }
     if (txn.nonce != storage.get_nonce(from)) _throw(NONCE_MISMATCH);
     uint160_t to = txn.has_to ? txn.to : _handles(gen_contract_address)(from, storage.get_nonce(from));
     storage.increment_nonce(from);
@@ -6302,5 +8459,21 @@ static void _throws(vm_txn)(Block &block, State &state, const uint8_t *buffer, u
 
     storage.flush();
 }
+static void _throws(vm_txn)(Block &block, State &state, const uint8_t *buffer, uint64_t size, uint160_t sender, bool pays_gas)
+{
+    Release release = get_release(block.forknumber());
+
+    struct txn txn = {0, 0, 0, false, 0, 0, nullptr, 0, false, 0, 0, 0, nullptr, 0, 0};
+    _handles(decode_txn)(buffer, size, txn);
+    _handles(verify_txn)(release, txn);
+
+    uint160_t from = sender;
+    if (sender == 0) {
+        Error result;
+        recover_senders(release, &txn, 1, &from, &result);
+        if (result != NONE) _throw(result);
+    }
+    _handles(vm_txn)(block, state, txn, from, pays_gas);
+}
 
 #endif // EVM_HPP
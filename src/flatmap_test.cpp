@@ -0,0 +1,93 @@
+#include <iomanip>
+#include <iostream>
+
+#include "evm.hpp"
+
+// every key lands on the same home slot
+struct CollidingHash {
+    template<class K> static inline uint64_t hash(const K &key) { return 0; }
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+    if (!ok) { std::cerr << "failed: " << what << std::endl; failures++; }
+}
+
+// keys sharing a hash past the longest probe are spilled, not grown into
+static void test_colliding_keys() {
+    const uint64_t n = 1000;
+    FlatMap<uint160_t, uint64_t, CollidingHash> map;
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t *p = map.insert(i, i);
+        check(p != nullptr && *p == i, "insert returns the value");
+    }
+    check(map.keys() == n, "key count");
+    check(map.slots() < 4 * n, "table bounded by the load");
+    for (uint64_t i = 0; i < n; i++) {
+        const uint64_t *p = map.find(i);
+        check(p != nullptr && *p == i, "find after insert");
+    }
+    check(map.find(n) == nullptr, "absent key");
+    uint64_t seen = 0;
+    for (uint64_t i = 0; i < map.slots(); i++) {
+        if (map.slot(i) != nullptr) seen++;
+    }
+    check(seen == n, "iteration visits every key");
+    for (uint64_t i = 0; i < n; i += 2) check(map.remove(i), "remove");
+    for (uint64_t i = 0; i < n; i++) check((map.find(i) != nullptr) == (i % 2 == 1), "find after remove");
+    for (uint64_t i = 0; i < map.slots(); ) {
+        if (map.slot(i) != nullptr) { map.remove_slot(i); continue; }
+        i++;
+    }
+    check(map.keys() == 0, "sweep removes every key");
+    for (uint64_t i = 0; i < n; i++) map.insert(i, i);
+    map.clear();
+    check(map.keys() == 0 && map.find(0) == nullptr, "clear");
+}
+
+// removing and inserting colliding keys keeps the spill consistent
+static void test_colliding_churn() {
+    FlatMap<uint160_t, uint64_t, CollidingHash> map;
+    for (uint64_t i = 0; i < 300; i++) map.insert(i, i);
+    for (uint64_t i = 0; i < 300; i++) {
+        map.remove(i);
+        map.insert(i + 300, i);
+    }
+    check(map.keys() == 300, "key count after churn");
+    for (uint64_t i = 300; i < 600; i++) check(map.find(i) != nullptr, "find after churn");
+}
+
+// flipping the top bit of two limbs does not collide whatever the seed
+static void test_limb_flips() {
+    const uint256_t flip = uint256_t(1) << 63 | uint256_t(1) << 127;
+    uint64_t collisions = 0;
+    for (uint64_t i = 0; i < 1000; i++) {
+        hash_seed = i * 0x9e3779b97f4a7c15L + 1;
+        uint256_t key = uint256_t(i) << 192 | uint256_t(i);
+        if (FoldHash::hash(key) == FoldHash::hash(key ^ flip)) collisions++;
+    }
+    check(collisions == 0, "limb flips collide");
+}
+
+// slot keys built before the seed changes hash as those built after
+static void test_reseeded_slotkey() {
+    uint64_t seed = hash_seed;
+    hash_seed = 1;
+    slotkey before(uint160_t(7), uint256_t(11));
+    hash_seed = 2;
+    slotkey after(uint160_t(7), uint256_t(11));
+    check(FoldHash::hash(before) == FoldHash::hash(after), "slot key hash after reseeding");
+    check(before == after, "slot key equality after reseeding");
+    hash_seed = seed;
+}
+
+int main() {
+    test_colliding_keys();
+    test_colliding_churn();
+    test_limb_flips();
+    test_reseeded_slotkey();
+    if (failures > 0) return 1;
+    std::cout << "flatmap ok" << std::endl;
+    return 0;
+}
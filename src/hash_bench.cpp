@@ -0,0 +1,91 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "evm.hpp"
+
+// compares the fold hash against murmur3 on the keys the state maps hold
+// distribution is the chi-square of the keys over as many buckets as the
+// table would have, normalized so that a uniform hash scores about 1.0,
+// with the fullest bucket, throughput is the mean hash and lookup times
+// both hashes are timed from the key, slot keys also get a row for the
+// fold cached when they are built, which is what the state maps use
+
+static const uint64_t rounds = 20;
+static volatile uint64_t sink; // keeps the timed loops
+
+// fold recomputed on every call, as murmur3 is
+struct UncachedFoldHash {
+    template<class K> static inline uint64_t hash(const K &key) { return key.fold(hash_seed); }
+    static inline uint64_t hash(const slotkey &key) { return key.key.fold(key.address.fold(hash_seed)); }
+};
+
+template<class H, class K>
+static void run(const char *name, const char *policy, const std::vector<K> &keys) {
+    uint64_t n = keys.size(), buckets = 1;
+    while (buckets < n) buckets *= 2;
+    std::vector<uint64_t> load(buckets, 0);
+    for (uint64_t i = 0; i < n; i++) load[H::hash(keys[i]) & (buckets - 1)]++;
+    double expected = (double)n / buckets, chi = 0;
+    uint64_t fullest = 0;
+    for (uint64_t i = 0; i < buckets; i++) {
+        chi += (load[i] - expected) * (load[i] - expected) / expected;
+        fullest = _max(fullest, load[i]);
+    }
+    FlatMap<K, uint64_t, H> map;
+    for (uint64_t i = 0; i < n; i++) map.insert(keys[i], i);
+    uint64_t sum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (uint64_t i = 0; i < n; i++) sum += H::hash(keys[i]);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (uint64_t i = 0; i < n; i++) sum += *map.find(keys[i]);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    sink = sum;
+    double hash_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (rounds * n);
+    double find_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / (rounds * n);
+    std::cout << std::left << std::setw(12) << name << std::setw(9) << policy << std::right
+        << " keys " << std::setw(7) << n
+        << " chi2 " << std::fixed << std::setprecision(3) << std::setw(6) << chi / buckets
+        << " fullest " << std::setw(2) << fullest
+        << " hash " << std::setprecision(1) << std::setw(5) << hash_ns << " ns"
+        << " find " << std::setw(5) << find_ns << " ns" << std::endl;
+}
+
+template<class K>
+static void both(const char *name, const std::vector<K> &keys) {
+    run<Murmur3Hash>(name, "murmur3", keys);
+    run<UncachedFoldHash>(name, "fold", keys);
+}
+
+static void both(const char *name, const std::vector<slotkey> &keys) {
+    run<Murmur3Hash>(name, "murmur3", keys);
+    run<UncachedFoldHash>(name, "fold", keys);
+    run<FoldHash>(name, "cached", keys);
+}
+
+int main() {
+    for (uint64_t n : { 1000, 100000 }) {
+        std::vector<uint160_t> addresses;
+        std::vector<uint256_t> hashed, sequential;
+        std::vector<slotkey> slots;
+        for (uint64_t i = 0; i < n; i++) {
+            uint8_t b[32];
+            for (int j = 0; j < 32; j++) b[j] = (uint8_t)(i >> (8 * (j % 8)));
+            uint256_t h = sha3(b, 32);
+            addresses.push_back((uint160_t)h);
+            hashed.push_back(sha3(b, 31));
+            sequential.push_back(i);
+            slots.push_back(slotkey((uint160_t)(i % 16), i < n / 2 ? uint256_t(i) : h));
+        }
+        both("address", addresses);
+        both("keccak", hashed);
+        both("sequential", sequential);
+        both("slotkey", slots);
+    }
+    return 0;
+}
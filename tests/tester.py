@@ -67,6 +67,7 @@ def compileFile(fnamein, fnameout):
         "-Wno-unused-but-set-variable",
         "-Wno-maybe-uninitialized",
         "-O0", # -Os crashes on some tests
+        "-pthread",
         "-o",
         fnameout,
         fnamein,